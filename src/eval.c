@@ -19,9 +19,12 @@
   GNU General Public License for more details.
 */
 
+#include <stdio.h>      /* for FILE in zetadva.h */
+
 #include "bitboard.h"   /* for population count, pop_count */
 #include "pst.h"        /* piece square tables, wood count, table control */
 #include "types.h"      /* custom types, board defs, data structures, macros */
+#include "zetadva.h"    /* for global vars, pawn hash table */
 
 /* 
   simple evaluation, based on proposal by Tomasz Michniewski
@@ -42,12 +45,86 @@ Score evalmove(Piece piece, Square sq)
 
   return score;
 }
+/* fill bitboard to north resp. south */
+static Bitboard northfill(Bitboard bb)
+{
+  bb |= bb<<8;
+  bb |= bb<<16;
+  bb |= bb<<32;
+  return bb;
+}
+static Bitboard southfill(Bitboard bb)
+{
+  bb |= bb>>8;
+  bb |= bb>>16;
+  bb |= bb>>32;
+  return bb;
+}
+/* evaluate pawn structure, cached via pawn hash table of search context */
+struct PTE *evalpawns(Bitboard *board, struct PTE *pt)
+{
+  Score score = 0;
+  s32 side;
+  File file;
+  s32 n;
+  Hash hash = board[QBBPHASH];
+  Bitboard bbPawns;
+  Bitboard bbFiles;
+  Bitboard bbAdjacent;
+  Bitboard bbSpan;
+  Bitboard bbSide[2];
+  struct PTE *pte = &pt[hash&(PTSIZE-1)];
+
+  if (pte->hash==hash)
+    return pte;
+
+  bbPawns       = board[QBBP1]&~board[QBBP2]&~board[QBBP3];
+  bbSide[BLACK] = bbPawns&board[QBBBLACK];
+  bbSide[WHITE] = bbPawns&~board[QBBBLACK];
+
+  /* chain */
+  score+= 10*popcount(bbSide[WHITE]&(bbSide[WHITE]<<7)&BBNOTHFILE);
+  score+= 10*popcount(bbSide[WHITE]&(bbSide[WHITE]<<9)&BBNOTAFILE);
+  score-= 10*popcount(bbSide[BLACK]&(bbSide[BLACK]>>7)&BBNOTAFILE);
+  score-= 10*popcount(bbSide[BLACK]&(bbSide[BLACK]>>9)&BBNOTHFILE);
+  /* column, each pair of pawns on same file */
+  for (file=FILE_A;file<FILE_NONE;file++)
+  {
+    n = popcount(bbSide[WHITE]&(BBFILEA<<file));
+    score-= 30*(n*(n-1)/2);
+    n = popcount(bbSide[BLACK]&(BBFILEA<<file));
+    score+= 30*(n*(n-1)/2);
+  }
+
+  pte->hash       = hash;
+  pte->score      = score;
+  pte->passed     = BBEMPTY;
+  pte->isolated   = BBEMPTY;
+  pte->openfiles  = (u8)~(southfill(bbPawns)&0xFF);
+
+  for (side=WHITE;side<=BLACK;side++)
+  {
+    /* files without own pawns */
+    bbFiles = southfill(northfill(bbSide[side]));
+    pte->halfopen[side] = (u8)~(bbFiles&0xFF);
+    /* isolated, no own pawns on adjacent files */
+    bbAdjacent = ((bbFiles<<1)&BBNOTAFILE)|((bbFiles>>1)&BBNOTHFILE);
+    pte->isolated|= bbSide[side]&~bbAdjacent;
+    /* passed, no enemy pawns in front on same or adjacent files */
+    bbSpan = bbSide[!side]
+             |((bbSide[!side]<<1)&BBNOTAFILE)
+             |((bbSide[!side]>>1)&BBNOTHFILE);
+    bbSpan = (side==WHITE)?southfill(bbSpan>>8):northfill(bbSpan<<8);
+    pte->passed|= bbSide[side]&~bbSpan;
+  }
+
+  return pte;
+}
 /* evaluate board position, no checkmates or stalemates */
-Score eval(Bitboard *board)
+Score eval(Bitboard *board, struct PTE *pt)
 {
   Score score = 0;
   s32 side;
-  Square i;
   Square sq;
   PieceType piecetype;
   Bitboard bbWork;
@@ -76,32 +153,40 @@ Score eval(Bitboard *board)
       score+= (side)?-EvalTable[piecetype*64+sq]:EvalTable[piecetype*64+FLIPFLOP(sq)];
       /* square control table */
       score+= (side)?-EvalControl[sq]:EvalControl[FLIPFLOP(sq)];
-
-      /* simple pawn structure white */
-      /* blocked */
-      score-=(piecetype==PAWN&&side==WHITE&&GETRANK(sq)<RANK_8&&(bbBoth[BLACK]&SETMASKBB(sq+8)))?15:0;
-        /* chain */
-      score+=(piecetype==PAWN&&side==WHITE&&GETFILE(sq)<FILE_H&&(bbPawns&bbBoth[WHITE]&SETMASKBB(sq-7)))?10:0;
-      score+=(piecetype==PAWN&&side==WHITE&&GETFILE(sq)>FILE_A&&(bbPawns&bbBoth[WHITE]&SETMASKBB(sq-9)))?10:0;
-      /* column */
-      for(i=sq-8;i>7&&piecetype==PAWN&&side==WHITE;i-=8)
-        score-=(bbPawns&bbBoth[WHITE]&SETMASKBB(i))?30:0;
-
-      /* simple pawn structure black */
-      /* blocked */
-      score+=(piecetype==PAWN&&side==BLACK&&GETRANK(sq)>RANK_1&&(bbBoth[WHITE]&SETMASKBB(sq-8)))?15:0;
-        /* chain */
-      score-=(piecetype==PAWN&&side==BLACK&&GETFILE(sq)>FILE_A&&(bbPawns&bbBoth[BLACK]&SETMASKBB(sq+7)))?10:0;
-      score-=(piecetype==PAWN&&side==BLACK&&GETFILE(sq)<FILE_H&&(bbPawns&bbBoth[BLACK]&SETMASKBB(sq+9)))?10:0;
-      /* column */
-      for(i=sq+8;i<56&&piecetype==PAWN&&side==BLACK;i+=8)
-        score+=(bbPawns&bbBoth[BLACK]&SETMASKBB(i))?30:0;
-
     }
     /* duble bishop */
     score+= (popcount(bbBoth[side]&(~board[QBBP1]&~board[QBBP2]&board[QBBP3]))==2)?(side)?-25:25:0;
     
   }
+  /* simple pawn structure, blocked by any enemy piece */
+  score-= 15*popcount(((bbPawns&bbBoth[WHITE])<<8)&bbBoth[BLACK]);
+  score+= 15*popcount(((bbPawns&bbBoth[BLACK])>>8)&bbBoth[WHITE]);
+  /* simple pawn structure, chain and column, via pawn hash table */
+  score+= evalpawns(board, pt)->score;
+
   return score;
 }
+/* evaluate board position via lock-free eval cache */
+/* entry packs upper hash bits and score into one word, no torn reads */
+Score evalcached(struct SearchContext *ctx, Bitboard *board)
+{
+  Score score;
+  Hash hash = board[QBBHASH];
+  u64 entry;
 
+  if (!EvalCache)
+    return eval(board, ctx->pt);
+
+  ctx->evcprobes++;
+
+  entry = EvalCache[hash&(EVCSIZE-1)];
+  if (entry!=HASHNONE&&(entry&EVCKEYMASK)==(hash&EVCKEYMASK))
+  {
+    ctx->evchits++;
+    return (Score)(entry&0xFFFF);
+  }
+  score = eval(board, ctx->pt);
+  EvalCache[hash&(EVCSIZE-1)] = (hash&EVCKEYMASK)|((u64)score&0xFFFF);
+
+  return score;
+}
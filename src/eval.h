@@ -29,7 +29,9 @@ extern const Score EvalControl[64];
 extern const Score EvalTable[7*64];
 
 Score evalmove(PieceType piece, Square sq);
-Score eval(Bitboard *board);
+struct PTE *evalpawns(Bitboard *board, struct PTE *pt);
+Score eval(Bitboard *board, struct PTE *pt);
+Score evalcached(struct SearchContext *ctx, Bitboard *board);
 
 #endif /* EVAL_H_INCLUDED */
 
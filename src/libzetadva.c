@@ -0,0 +1,146 @@
+/*
+  Name:         Zeta Dva
+  Description:  Amateur level chess engine
+  Author:       Srdja Matovic <s.matovic@app26.de>
+  Created at:   2011-01-15
+  Updated at:   2019
+  License:      GPL >= v2
+
+  Copyright (C) 2011-2019 Srdja Matovic
+
+  Zeta Dva is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  Zeta Dva is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+*/
+
+#include <stdio.h>      /* for FILE in zetadva.h */
+#include <stdlib.h>     /* for calloc and free */
+#include <string.h>     /* for strcat */
+
+#include "libzetadva.h" /* library interface */
+#include "search.h"     /* for search context and rootsearch */
+#include "types.h"      /* custom types, board defs, data structures, macros */
+#include "zetadva.h"    /* for fen parsing, tt and eval cache */
+
+/* allocate eval cache shared by all contexts, call once before searching */
+bool zetadva_init(void)
+{
+  if (!EvalCache)
+    EvalCache = (u64 *)calloc(EVCSIZE, sizeof(u64));
+  return (EvalCache!=NULL);
+}
+/* release eval cache, no search may run */
+void zetadva_release(void)
+{
+  if (EvalCache)
+    free(EvalCache);
+  EvalCache = NULL;
+}
+/* create transposition table of given mega bytes, for one or more contexts */
+struct TTable *zetadva_newtt(u64 mb)
+{
+  struct TTable *tt;
+
+  tt = (struct TTable*)calloc(1, sizeof(struct TTable));
+  if (!tt)
+    return NULL;
+  tt->entries = ttentries(mb);
+  tt->slots   = (struct TTSlot*)calloc(tt->entries, sizeof(struct TTSlot));
+  if (!tt->slots)
+  {
+    free(tt);
+    return NULL;
+  }
+  return tt;
+}
+/* release transposition table, no context may use it anymore */
+void zetadva_freett(struct TTable *tt)
+{
+  if (!tt)
+    return;
+  if (tt->slots)
+    free(tt->slots);
+  free(tt);
+}
+/* create search context on given tt, NULL for no tt, start position set */
+struct SearchContext *zetadva_create(struct TTable *tt)
+{
+  struct SearchContext *ctx = createcontext(tt);
+
+  if (ctx&&!zetadva_setfen(ctx, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"))
+  {
+    releasecontext(ctx);
+    return NULL;
+  }
+  return ctx;
+}
+/* release search context, its tt is kept */
+void zetadva_free(struct SearchContext *ctx)
+{
+  releasecontext(ctx);
+}
+/* set root position, game history starts at given position */
+bool zetadva_setfen(struct SearchContext *ctx, char *fen)
+{
+  Bitboard board[8];
+  bool stm;
+  s32 gameply;
+
+  if (!parsefen(board, &stm, &gameply, fen))
+    return false;
+
+  memcpy(ctx->board, board, 8*sizeof(Bitboard));
+  ctx->stm            = stm;
+  ctx->ply            = 0;
+  ctx->hashhistory[0] = board[QBBHASH];
+  ctx->bestmove       = MOVENONE;
+  ctx->pvcount        = 0;
+  return true;
+}
+/* search root position, limits of 0 are ignored, returns false without
+   legal move */
+bool zetadva_search(struct SearchContext *ctx, s32 depth, u64 nodes, double msec)
+{
+  ctx->maxdepth = (depth>0)?MIN(depth, MAXPLY-1):MAXPLY;
+  ctx->maxnodes = nodes;
+  ctx->maxtime  = (msec>0)?msec:24.0*60*60*1000;
+
+  return (rootsearch(ctx)!=MOVENONE);
+}
+/* abort running search of context, from another thread */
+void zetadva_stop(struct SearchContext *ctx)
+{
+  *ctx->stop = true;
+}
+/* get result of last search */
+void zetadva_result(struct SearchContext *ctx, struct ZetadvaResult *result)
+{
+  s32 i;
+  char movec[6];
+
+  memset(result, 0, sizeof(struct ZetadvaResult));
+
+  if (ctx->bestmove!=MOVENONE)
+    move2can(ctx->bestmove, result->bestmove);
+  result->score   = (s32)ctx->score;
+  result->mate    = ISMATE(ctx->score);
+  if (result->mate)
+    result->mateply = (ctx->score>0)?INF-ctx->score:-(INF+ctx->score);
+  result->depth   = ctx->depth;
+  result->nodes   = ctx->nodes;
+  result->time    = ctx->elapsed;
+  for (i=0;i<ctx->pvcount;i++)
+  {
+    move2can(ctx->pv[i], movec);
+    if (i>0)
+      strcat(result->pv, " ");
+    strcat(result->pv, movec);
+  }
+}
+
@@ -0,0 +1,68 @@
+/*
+  Name:         Zeta Dva
+  Description:  Amateur level chess engine
+  Author:       Srdja Matovic <s.matovic@app26.de>
+  Created at:   2011-01-15
+  Updated at:   2019
+  License:      GPL >= v2
+
+  Copyright (C) 2011-2019 Srdja Matovic
+
+  Zeta Dva is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  Zeta Dva is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+*/
+
+#ifndef LIBZETADVA_H_INCLUDED
+#define LIBZETADVA_H_INCLUDED
+
+#include "types.h"      /* custom types, board defs, data structures, macros */
+
+/*
+  library interface, build via make libzetadva.a
+
+  every search context holds its own position, tables and limits, so
+  many contexts can search concurrently, one thread per context.
+  transposition tables are created separately and can be private to one
+  context or shared by several, entries are lock-free.
+
+    struct TTable *tt = zetadva_newtt(64);
+    struct SearchContext *ctx = zetadva_create(tt);
+    zetadva_setfen(ctx, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    zetadva_search(ctx, 10, 0, 1000);
+    zetadva_result(ctx, &result);
+    zetadva_free(ctx);
+    zetadva_freett(tt);
+*/
+
+/* result of last search of a context */
+struct ZetadvaResult {
+        char bestmove[6];   /* coordinate notation, empty if no move */
+        s32 score;          /* centipawns, side to move point of view */
+        bool mate;          /* score is a mate in mateply plies */
+        s32 mateply;        /* positive if side to move mates */
+        s32 depth;          /* last completed iteration */
+        u64 nodes;          /* nodes of all search threads */
+        double time;        /* milli-seconds */
+        char pv[MAXPLY*6];  /* principal variation, space separated */
+};
+
+bool zetadva_init(void);
+void zetadva_release(void);
+struct TTable *zetadva_newtt(u64 mb);
+void zetadva_freett(struct TTable *tt);
+struct SearchContext *zetadva_create(struct TTable *tt);
+void zetadva_free(struct SearchContext *ctx);
+bool zetadva_setfen(struct SearchContext *ctx, char *fen);
+bool zetadva_search(struct SearchContext *ctx, s32 depth, u64 nodes, double msec);
+void zetadva_stop(struct SearchContext *ctx);
+void zetadva_result(struct SearchContext *ctx, struct ZetadvaResult *result);
+
+#endif /* LIBZETADVA_H_INCLUDED */
+
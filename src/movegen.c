@@ -206,11 +206,11 @@ int genmoves_castles(Bitboard *board, Move *moves, int movecounter, bool stm)
   /* get castle rights queenside */
   bbTempA = (stm)?(((~board[QBBPMVD])&SMCRBLACKQ)==SMCRBLACKQ)?true:false:(((~board[QBBPMVD])&SMCRWHITEQ)==SMCRWHITEQ)?true:false;
   /* rook present */
-  bbTempA = (GETPIECE(board, sqfrom-4)==MAKEPIECE(ROOK,stm))?bbTempA:false;
+  bbTempA = (bbTempA&&GETPIECE(board, sqfrom-4)==MAKEPIECE(ROOK,stm))?true:false;
   /* check for empty squares */
   bbTempB = ((bbBlockers&SETMASKBB(sqfrom-1))|(bbBlockers&SETMASKBB(sqfrom-2))|(bbBlockers&SETMASKBB(sqfrom-3)));
-  /* check for king and empty squares in check */
-  bbTempC =  (squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom-1)|squareunderattack(board,!stm,sqfrom-2));
+  /* check for king and empty squares in check, king on castle square only */
+  bbTempC =  (bbTempA&&!bbTempB)?(squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom-1)|squareunderattack(board,!stm,sqfrom-2)):true;
   /* set castle move score */
   score   = INF-100;
   /* make move */
@@ -224,11 +224,11 @@ int genmoves_castles(Bitboard *board, Move *moves, int movecounter, bool stm)
   /* get castle rights kingside */
   bbTempA = (stm)?(((~board[QBBPMVD])&SMCRBLACKK)==SMCRBLACKK)?true:false:(((~board[QBBPMVD])&SMCRWHITEK)==SMCRWHITEK)?true:false;
   /* rook present */
-  bbTempA = (GETPIECE(board, sqfrom+3)==MAKEPIECE(ROOK,stm))?bbTempA:false;
+  bbTempA = (bbTempA&&GETPIECE(board, sqfrom+3)==MAKEPIECE(ROOK,stm))?true:false;
   /* check for empty squares */
   bbTempB = ((bbBlockers&SETMASKBB(sqfrom+1))|(bbBlockers&SETMASKBB(sqfrom+2)));
-  /* check for king and empty squares in check */
-  bbTempC =  (squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom+1)|squareunderattack(board,!stm,sqfrom+2));
+  /* check for king and empty squares in check, king on castle square only */
+  bbTempC =  (bbTempA&&!bbTempB)?(squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom+1)|squareunderattack(board,!stm,sqfrom+2)):true;
   /* set castle move score */
   score   = INF-90;
   /* make move */
@@ -427,11 +427,12 @@ int genmoves_captures(Bitboard *board, Move *moves, int movecounter, bool stm)
   return movecounter;
 }
 /* quiet moves only */
-int genmoves_noncaptures(Bitboard *board, Move *moves, int movecounter, bool stm, s32 ply) 
+int genmoves_noncaptures(struct SearchContext *ctx, Bitboard *board, Move *moves, int movecounter, bool stm, s32 ply) 
 {
   bool kic = false;
   Score score;
   s32 i;
+  s32 hist;
   Piece pfrom;
   Piece pto;
   Square sqfrom;
@@ -524,10 +525,19 @@ int genmoves_noncaptures(Bitboard *board, Move *moves, int movecounter, bool stm
       /* pack move into 64 bits, considering castle rights and halfmovecounter and score */
       move = MAKEMOVE(sqfrom, sqto, sqto, pfrom, pto, PNONE, 0, (Move)GETHMC(lastmove), (Move)score);
 
-      /* set killers and counters score */
-      if (JUSTMOVE(move)==JUSTMOVE(Counters[GETSQFROM(lastmove)*64+GETSQTO(lastmove)]))
+      /* set history, killers and counters score, of search context if any */
+      if (ctx)
+      {
+        hist = ctx->history[HISTINDEX(stm, move)];
+        if (JUSTMOVE(lastmove)!=MOVENONE&&JUSTMOVE(lastmove)!=NULLMOVE)
+          hist+= ctx->conthistory[CONTHISTINDEX(lastmove, move)];
+        score+= (Score)(hist/4);
+      }
+      if (ctx&&JUSTMOVE(move)==JUSTMOVE(ctx->counters[GETSQFROM(lastmove)*64+GETSQTO(lastmove)]))
+        score = INF-30;
+      if (ctx&&JUSTMOVE(move)==JUSTMOVE(ctx->killers[ply*2+1]))
         score = INF-20;
-      if (JUSTMOVE(move)==JUSTMOVE(Killers[ply]))
+      if (ctx&&JUSTMOVE(move)==JUSTMOVE(ctx->killers[ply*2]))
         score = INF-10;
 
       move = SETSCORE(move,(Move)score);
@@ -749,11 +759,11 @@ int genmoves_general(Bitboard *board, Move *moves, int movecounter, bool stm, bo
   /* get castle rights queenside */
   bbTemp  = (stm)?(((~board[QBBPMVD])&SMCRBLACKQ)==SMCRBLACKQ)?true:false:(((~board[QBBPMVD])&SMCRWHITEQ)==SMCRWHITEQ)?true:false;
   /* rook present */
-  bbTemp  = (GETPIECE(board, sqfrom-4)==MAKEPIECE(ROOK,stm))?bbTemp:false;
+  bbTemp  = (bbTemp&&GETPIECE(board, sqfrom-4)==MAKEPIECE(ROOK,stm))?true:false;
   /* check for empty squares */
   bbPro   = ((bbBlockers&SETMASKBB(sqfrom-1))|(bbBlockers&SETMASKBB(sqfrom-2))|(bbBlockers&SETMASKBB(sqfrom-3)));
   /* check for king and empty squares in check */
-  bbGen  =  (squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom-1)|squareunderattack(board,!stm,sqfrom-2));
+  bbGen  =  (bbTemp&&!bbPro)?(squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom-1)|squareunderattack(board,!stm,sqfrom-2)):true;
   /* set castle move score */
   score   = INF-100;
   /* make move */
@@ -767,11 +777,11 @@ int genmoves_general(Bitboard *board, Move *moves, int movecounter, bool stm, bo
   /* get castle rights kingside */
   bbTemp  = (stm)?(((~board[QBBPMVD])&SMCRBLACKK)==SMCRBLACKK)?true:false:(((~board[QBBPMVD])&SMCRWHITEK)==SMCRWHITEK)?true:false;
   /* rook present */
-  bbTemp  = (GETPIECE(board, sqfrom+3)==MAKEPIECE(ROOK,stm))?bbTemp:false;
+  bbTemp  = (bbTemp&&GETPIECE(board, sqfrom+3)==MAKEPIECE(ROOK,stm))?true:false;
   /* check for empty squares */
   bbPro   = ((bbBlockers&SETMASKBB(sqfrom+1))|(bbBlockers&SETMASKBB(sqfrom+2)));
   /* check for king and empty squares in check */
-  bbGen  =  (squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom+1)|squareunderattack(board,!stm,sqfrom+2));
+  bbGen  =  (bbTemp&&!bbPro)?(squareunderattack(board,!stm,sqfrom)|squareunderattack(board,!stm,sqfrom+1)|squareunderattack(board,!stm,sqfrom+2)):true;
   /* set castle move score */
   score   = INF-90;
   /* make move */
@@ -783,7 +793,7 @@ int genmoves_general(Bitboard *board, Move *moves, int movecounter, bool stm, bo
   return movecounter;
 }
 /* wrapper for move genration */
-int genmoves(Bitboard *board, Move *moves, int movecounter, bool stm, bool qs, s32 ply)
+int genmoves(struct SearchContext *ctx, Bitboard *board, Move *moves, int movecounter, bool stm, bool qs, s32 ply)
 {
 
 /*
@@ -800,7 +810,7 @@ int genmoves(Bitboard *board, Move *moves, int movecounter, bool stm, bool qs, s
   movecounter = genmoves_captures(board, moves, movecounter, stm);
 
   if (!qs)
-    movecounter = genmoves_noncaptures(board, moves, movecounter, stm, ply);
+    movecounter = genmoves_noncaptures(ctx, board, moves, movecounter, stm, ply);
 
   return movecounter;
 }
@@ -1008,3 +1018,81 @@ Bitboard bishop_attacks(Bitboard bbBlockers, Square sq)
          ks_attacks_rs9(bbBlockers, sq);
 }
 
+/* piece values for static exchange evaluation, king is captured last */
+static const s32 SeeValues[7] = {0, 100, 400, 10000, 400, 600, 1200};
+/* bitboard of all pieces of given type, both colors */
+Bitboard piecetypes(Bitboard *board, s32 type)
+{
+  return ((type&1)?board[QBBP1]:~board[QBBP1])
+        &((type&2)?board[QBBP2]:~board[QBBP2])
+        &((type&4)?board[QBBP3]:~board[QBBP3]);
+}
+/* all pieces of both colors attacking square, for given occupancy */
+static Bitboard attackers(Bitboard *board, Bitboard bbOcc, Square sq)
+{
+  Bitboard bbPawns = piecetypes(board, PAWN);
+
+  return ((rook_attacks(bbOcc, sq)&(piecetypes(board, ROOK)|piecetypes(board, QUEEN)))
+         |(bishop_attacks(bbOcc, sq)&(piecetypes(board, BISHOP)|piecetypes(board, QUEEN)))
+         |(AttackTables[KNIGHT*64+sq]&piecetypes(board, KNIGHT))
+         |(AttackTables[KING*64+sq]&piecetypes(board, KING))
+         |(AttackTables[BLACK*64+sq]&bbPawns&~board[QBBBLACK])
+         |(AttackTables[WHITE*64+sq]&bbPawns&board[QBBBLACK]))
+         &bbOcc;
+}
+/* static exchange evaluation, material balance of capture sequence on
+   target square, least valuable attacker first, x-rays behind sliders */
+Score see(Bitboard *board, Move move)
+{
+  static const s32 order[6] = {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING};
+  bool color = (bool)GETCOLOR(GETPFROM(move));
+  s32 gain[32];
+  s32 d = 0;
+  s32 i;
+  s32 type = GETPTYPE(GETPTO(move));
+  Square sqto = GETSQTO(move);
+  Bitboard bbOcc = board[QBBP1]|board[QBBP2]|board[QBBP3];
+  Bitboard bbFrom = SETMASKBB(GETSQFROM(move));
+  Bitboard bbSide;
+  Bitboard bbWork;
+  Bitboard bbAttackers;
+  Bitboard bbDiagonal = piecetypes(board, BISHOP)|piecetypes(board, QUEEN);
+  Bitboard bbStraight = piecetypes(board, ROOK)|piecetypes(board, QUEEN);
+
+  /* captured piece, promotion gain, en passant pawn leaves its square */
+  gain[0] = SeeValues[GETPTYPE(GETPCPT(move))]
+           +SeeValues[type]-SeeValues[GETPTYPE(GETPFROM(move))];
+  bbOcc&= CLRMASKBB(GETSQCPT(move));
+  bbAttackers = attackers(board, bbOcc, sqto);
+
+  do {
+    d++;
+    /* speculative gain, if piece on target square is recaptured */
+    gain[d] = SeeValues[type]-gain[d-1];
+    /* remove attacker, add x-ray attackers behind it */
+    bbOcc      &= ~bbFrom;
+    bbAttackers&= bbOcc;
+    bbAttackers|= ((rook_attacks(bbOcc, sqto)&bbStraight)
+                  |(bishop_attacks(bbOcc, sqto)&bbDiagonal))&bbOcc;
+    /* least valuable attacker of other side */
+    color  = !color;
+    bbSide = (color)?board[QBBBLACK]:(bbOcc&~board[QBBBLACK]);
+    bbFrom = BBEMPTY;
+    for (i=0;i<6;i++)
+    {
+      bbWork = bbAttackers&bbSide&piecetypes(board, order[i]);
+      if (bbWork)
+      {
+        bbFrom = bbWork&(~bbWork+1);
+        type   = order[i];
+        break;
+      }
+    }
+  } while (bbFrom&&d<31);
+
+  /* negamax the gains back to first capture */
+  while (--d)
+    gain[d-1] = -MAX(-gain[d-1], gain[d]);
+
+  return (Score)gain[0];
+}
@@ -22,17 +22,21 @@
 #ifndef MOVEGEN_H_INCLUDED
 #define MOVEGEN_H_INCLUDED
 
-const Bitboard AttackTablesPawnPushes[4*64];
-const Bitboard AttackTables[7*64];
+#include "types.h"      /* custom types, board defs, data structures, macros */
 
-int genmoves(Bitboard *board, Move *moves, int movecounter, bool stm, bool qs, s32 ply);
+extern const Bitboard AttackTablesPawnPushes[2*64];
+extern const Bitboard AttackTables[7*64];
+
+int genmoves(struct SearchContext *ctx, Bitboard *board, Move *moves, int movecounter, bool stm, bool qs, s32 ply);
 int genmoves_general(Bitboard *board, Move *moves, int movecounter, bool stm, bool qs);
 int genmoves_promo(Bitboard *board, Move *moves, int movecounter, bool stm);
 int genmoves_castles(Bitboard *board, Move *moves, int movecounter, bool stm);
 int genmoves_enpassant(Bitboard *board, Move *moves, int movecounter, bool stm);
 int genmoves_captures(Bitboard *board, Move *moves, int movecounter, bool stm);
-int genmoves_noncaptures(Bitboard *board, Move *moves, int movecounter, bool stm, s32 ply);
+int genmoves_noncaptures(struct SearchContext *ctx, Bitboard *board, Move *moves, int movecounter, bool stm, s32 ply);
 Bitboard rook_attacks(Bitboard bbBlockers, Square sq);
 Bitboard bishop_attacks(Bitboard bbBlockers, Square sq);
+Bitboard piecetypes(Bitboard *board, s32 type);
+Score see(Bitboard *board, Move move);
 #endif /* MOVEGEN_H_INCLUDED */
 
@@ -18,116 +18,523 @@
   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
   GNU General Public License for more details.
 */
+#define _POSIX_C_SOURCE 200809L /* for posix threads */
 
 #include <stdio.h>      /* for print and scan */
 #include <stdlib.h>     /* for qsort */
 #include <math.h>       /* for pow */
+#include <string.h>     /* for memset */
+#include <pthread.h>    /* for smp helper threads */
 
 #include "bitboard.h"   /* for population count, pop_count */
 #include "book.h"       /* for polyglot book access */
 #include "eval.h"       /* for evalmove and eval */
 #include "movegen.h"    /* for move generator thingies */
+#include "search.h"     /* for search context and prototypes */
 #include "timer.h"      /* for time measurement */
 #include "types.h"      /* custom types, board defs, data structures, macros */
 #include "zetadva.h"    /* for global vars */
 
 /* forward declaration */
-Score negamax(Bitboard *board,
-              bool stm, 
-              Score alpha, 
-              Score beta, 
-              s32 depth, 
-              s32 ply, 
-              bool prune);
+static bool splitaborted(struct SearchContext *ctx);
+static Score split(struct SearchContext *ctx, Bitboard *board, bool stm,
+                   Score alpha, Score beta,
+                   s32 depth, s32 ply, bool prune, bool kic, bool ext,
+                   bool futile, s32 lmradjust, s32 lmplimit, Move *moves, s32 movecounter, Move ttmove,
+                   s32 movesplayed, s32 quietsplayed, Move *bestmove);
+
+/* smp helper thread job, lazy smp or ybwc worker */
+struct SMPJob {
+  pthread_t tid;
+  bool started;
+  struct SearchContext *ctx;  /* private context, root position copy */
+  Move moves[MAXMOVES];       /* root moves, ordered by main thread */
+  s32 movecounter;
+  volatile u64 nodes;         /* node count, published per root move or split */
+};
+
+/* young brothers wait split point, remaining moves of a node */
+struct SplitPoint {
+  pthread_mutex_t lock;
+  bool used;
+  struct SplitPoint *parent;    /* split point the master works for */
+  Bitboard board[8];
+  bool stm;
+  bool prune;
+  bool kic;
+  bool ext;
+  bool futile;
+  s32 lmradjust;
+  s32 lmplimit;
+  s32 depth;
+  s32 ply;
+  s32 gameply;                  /* PLY of master, index into hashes */
+  s32 nullminply;               /* null move verification state of master */
+  bool nullcolor;
+  Score beta;
+  volatile Score alpha;         /* shared alpha, raised by all threads */
+  volatile bool cutoff;         /* beta cutoff, abort all threads */
+  bool done;                    /* closed by master, no more slaves */
+  Move bestmove;
+  Move moves[MAXMOVES];
+  s32 movecounter;
+  s32 next;                     /* next move to search */
+  s32 movesplayed;
+  s32 quietsplayed;             /* quiet moves tried, for late move pruning */
+  s32 slaves;                   /* threads working besides master */
+  Hash hashes[MAXGAMEPLY];      /* game and search hashes, for repetitions */
+  Score evals[MAXPLY];          /* static evals up to ply, for improving */
+};
+/* smp state of one search, shared by main and helper threads */
+struct SMPState {
+  struct SMPJob jobs[MAXTHREADS];
+  struct SplitPoint splits[MAXSPLITS];
+  pthread_mutex_t lock;         /* guards used flags of split points */
+  pthread_cond_t work;          /* new split point, slave left or stop */
+  volatile s32 idle;            /* ybwc workers looking for work */
+  /* ybwc statistics, reset per search */
+  volatile u64 splitcount;
+  volatile u64 joincount;
+  volatile u64 abortcount;
+};
+
+/* forward pruning margins by remaining depth, index 0 unused */
+static const Score RfpMargins[4]      = {0, 200, 400, 600};
+static const Score FutilityMargins[4] = {0, 250, 400, 550};
+static const Score RazorMargins[4]    = {0, 400, 550, 700};
+/* late move pruning, moves searched by depth, not improving and improving */
+static const s32 LmpCounts[2][LMPDEPTH+1] = {{0, 3, 5, 9, 14}, {0, 5, 8, 14, 22}};
+
+/* late move reductions by depth and move number, log-log formula */
+static s32 LmrTable[LMRSIZE][LMRSIZE];
+static pthread_once_t TablesOnce = PTHREAD_ONCE_INIT;
+
+/* fill late move reduction table, once per process */
+static void initlmr(void)
+{
+  s32 d;
+  s32 m;
+
+  for (d=1;d<LMRSIZE;d++)
+    for (m=1;m<LMRSIZE;m++)
+      LmrTable[d][m] = (s32)(0.75+log((double)d)*log((double)m)/2.25);
+}
+
+/* cuckoo tables of reversible moves, keyed by zobrist difference of the
+   positions before and after, for upcoming repetition detection */
+static Hash CuckooKeys[CUCKOOSIZE];
+static u16 CuckooMoves[CUCKOOSIZE];   /* piece type, from and to square */
 
-/* perft, just node counting */
-Score perft(Bitboard *board, bool stm, s32 depth)
+#define CUCKOOH1(key)       ((key)&(CUCKOOSIZE-1))
+#define CUCKOOH2(key)       (((key)>>16)&(CUCKOOSIZE-1))
+#define REPINDEX(hash)      (((hash)>>32)&(REPSIZE-1))
+
+/* zobrist key of piece on square, as in computehash */
+static Hash zobristsq(Piece piece, Square sq)
+{
+  Hash zobrist = Zobrist[GETCOLOR(piece)*6+GETPTYPE(piece)-1];
+
+  return (sq)?((zobrist<<sq)|(zobrist>>(64-sq))):zobrist;
+}
+/* fill cuckoo tables with all non pawn moves on empty board, once per
+   process */
+static void initcuckoo(void)
+{
+  static const s32 types[5] = {KNIGHT, BISHOP, ROOK, QUEEN, KING};
+  s32 color;
+  s32 t;
+  s32 kicks;
+  Piece piece;
+  Square sqfrom;
+  Square sqto;
+  Bitboard bbMoves;
+  Hash key;
+  Hash tmpkey;
+  u16 move;
+  u16 tmpmove;
+  u64 slot;
+
+  for (color=WHITE;color<=BLACK;color++)
+  {
+    for (t=0;t<5;t++)
+    {
+      piece = MAKEPIECE(types[t], color);
+      for (sqfrom=0;sqfrom<64;sqfrom++)
+      {
+        if (types[t]==KNIGHT||types[t]==KING)
+          bbMoves = AttackTables[types[t]*64+sqfrom];
+        else
+          bbMoves = ((types[t]!=BISHOP)?rook_attacks(BBEMPTY, sqfrom):BBEMPTY)
+                   |((types[t]!=ROOK)?bishop_attacks(BBEMPTY, sqfrom):BBEMPTY);
+        /* each move once, from lower to higher square */
+        bbMoves&= ~(SETMASKBB(sqfrom)|(SETMASKBB(sqfrom)-1));
+        while (bbMoves)
+        {
+          sqto = (Square)popfirst1(&bbMoves);
+          key  = zobristsq(piece, sqfrom)^zobristsq(piece, sqto)^0x1ULL;
+          move = (u16)(types[t]<<12|sqfrom<<6|sqto);
+          /* insert, kick out residents to their other slot */
+          slot = CUCKOOH1(key);
+          for (kicks=0;kicks<CUCKOOSIZE&&move;kicks++)
+          {
+            tmpkey  = CuckooKeys[slot];
+            tmpmove = CuckooMoves[slot];
+            CuckooKeys[slot]  = key;
+            CuckooMoves[slot] = move;
+            key  = tmpkey;
+            move = tmpmove;
+            slot = (slot==CUCKOOH1(key))?CUCKOOH2(key):CUCKOOH1(key);
+          }
+        }
+      }
+    }
+  }
+}
+/* fill late move reduction and cuckoo tables */
+static void inittables(void)
+{
+  initlmr();
+  initcuckoo();
+}
+/* rebuild repetition filter from whole hash history, after it was copied */
+static void initrepfilter(struct SearchContext *ctx)
+{
+  s32 i;
+
+  memset(ctx->repfilter, 0, REPSIZE*sizeof(u16));
+  for (i=0;i<MAXGAMEPLY;i++)
+    ctx->repfilter[REPINDEX(ctx->hashhistory[i])]++;
+}
+/* side to move can reach a former position of search by one reversible
+   move, squares between from and to are empty */
+static bool upcomingrepetition(struct SearchContext *ctx, Bitboard *board,
+                               s32 ply, s32 hmc)
+{
+  s32 i;
+  s32 type;
+  Square sqfrom;
+  Square sqto;
+  Hash key;
+  u64 slot;
+  Bitboard bbBlockers = board[QBBP1]|board[QBBP2]|board[QBBP3];
+
+  for (i=3;i<=hmc&&i<ply;i+=2)
+  {
+    key  = board[QBBHASH]^ctx->hashhistory[ctx->ply+ply-i];
+    slot = CUCKOOH1(key);
+    if (CuckooKeys[slot]!=key)
+      slot = CUCKOOH2(key);
+    if (CuckooKeys[slot]!=key)
+      continue;
+    type   = CuckooMoves[slot]>>12;
+    sqfrom = (CuckooMoves[slot]>>6)&0x3F;
+    sqto   = CuckooMoves[slot]&0x3F;
+    if ((type==ROOK&&!(rook_attacks(bbBlockers, sqfrom)&SETMASKBB(sqto)))
+        ||(type==BISHOP&&!(bishop_attacks(bbBlockers, sqfrom)&SETMASKBB(sqto)))
+        ||(type==QUEEN&&!((rook_attacks(bbBlockers, sqfrom)|bishop_attacks(bbBlockers, sqfrom))&SETMASKBB(sqto))))
+      continue;
+    return true;
+  }
+  return false;
+}
+/* print transposition table statistics of last search */
+static void printttstats(struct SearchContext *ctx, FILE *file)
+{
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#tt probes: %" PRIu64 ", hits: %" PRIu64 ", collisions: %" PRIu64 ", cutoffs exact/lower/upper: %" PRIu64 "/%" PRIu64 "/%" PRIu64 ", stores: %" PRIu64 ", replaced empty/age/depth: %" PRIu64 "/%" PRIu64 "/%" PRIu64 ", hashfull: %d\n",
+          ctx->ttstats.probes, ctx->ttstats.hits, ctx->ttstats.collisions,
+          ctx->ttstats.cutexact, ctx->ttstats.cutlower, ctx->ttstats.cutupper,
+          ctx->ttstats.stores,
+          ctx->ttstats.replempty, ctx->ttstats.replage, ctx->ttstats.repldepth,
+          hashfull(ctx->tt));
+}
+/* allocate search context with private tables, tt is given by caller */
+struct SearchContext *createcontext(struct TTable *tt)
+{
+  struct SearchContext *ctx;
+
+  ctx = (struct SearchContext*)calloc(1, sizeof(struct SearchContext));
+  if (!ctx)
+    return NULL;
+
+  ctx->hashhistory  = (Hash*)calloc(MAXGAMEPLY, sizeof(Hash));
+  ctx->repfilter    = (u16*)calloc(REPSIZE, sizeof(u16));
+  ctx->killers      = (Move*)calloc(MAXPLY*2, sizeof(Move));
+  ctx->counters     = (Move*)calloc(64*64, sizeof(Move));
+  ctx->history      = (s16*)calloc(HISTSIZE, sizeof(s16));
+  ctx->conthistory  = (s16*)calloc(CONTHISTSIZE, sizeof(s16));
+  ctx->capthistory  = (s16*)calloc(CAPTHISTSIZE, sizeof(s16));
+  ctx->pt           = (struct PTE*)calloc(PTSIZE, sizeof(struct PTE));
+  if (!ctx->hashhistory||!ctx->repfilter||!ctx->killers||!ctx->counters||!ctx->history
+      ||!ctx->conthistory||!ctx->capthistory||!ctx->pt)
+  {
+    releasecontext(ctx);
+    return NULL;
+  }
+  ctx->tt       = tt;
+  ctx->maxdepth = MAXPLY;
+  ctx->maxtime  = 5*1000;
+  ctx->cores    = 1;
+  ctx->smpmode  = SMPLAZY;
+  ctx->stop     = &ctx->stopflag;
+  ctx->ttaging  = true;
+
+  pthread_once(&TablesOnce, inittables);
+
+  return ctx;
+}
+/* release search context and its private tables, not the tt */
+void releasecontext(struct SearchContext *ctx)
+{
+  s32 i;
+
+  if (!ctx)
+    return;
+  if (ctx->hashhistory)
+    free(ctx->hashhistory);
+  if (ctx->repfilter)
+    free(ctx->repfilter);
+  if (ctx->killers)
+    free(ctx->killers);
+  if (ctx->counters)
+    free(ctx->counters);
+  if (ctx->history)
+    free(ctx->history);
+  if (ctx->conthistory)
+    free(ctx->conthistory);
+  if (ctx->capthistory)
+    free(ctx->capthistory);
+  if (ctx->pt)
+    free(ctx->pt);
+  if (ctx->smp)
+  {
+    for (i=0;i<MAXSPLITS;i++)
+      pthread_mutex_destroy(&ctx->smp->splits[i].lock);
+    pthread_mutex_destroy(&ctx->smp->lock);
+    pthread_cond_destroy(&ctx->smp->work);
+    free(ctx->smp);
+  }
+  free(ctx);
+}
+/* clear move ordering heuristics and pawn hash table, for new game */
+void clearcontext(struct SearchContext *ctx)
+{
+  memset(ctx->killers, 0, MAXPLY*2*sizeof(Move));
+  memset(ctx->counters, 0, 64*64*sizeof(Move));
+  memset(ctx->history, 0, HISTSIZE*sizeof(s16));
+  memset(ctx->conthistory, 0, CONTHISTSIZE*sizeof(s16));
+  memset(ctx->capthistory, 0, CAPTHISTSIZE*sizeof(s16));
+  memset(ctx->pt, 0, PTSIZE*sizeof(struct PTE));
+}
+/* age history tables between searches, killers of former root are void */
+static void agehistory(struct SearchContext *ctx)
+{
+  s32 i;
+
+  memset(ctx->killers, 0, MAXPLY*2*sizeof(Move));
+  for (i=0;i<HISTSIZE;i++)
+    ctx->history[i]/= 2;
+  for (i=0;i<CONTHISTSIZE;i++)
+    ctx->conthistory[i]/= 2;
+  for (i=0;i<CAPTHISTSIZE;i++)
+    ctx->capthistory[i]/= 2;
+}
+/* capture loses material by static exchange evaluation, captures of
+   higher or equal valued pieces are never losing */
+static bool seelosing(Bitboard *board, Move move)
+{
+  if (GETPTYPE(GETPFROM(move))==KING
+      ||EvalPieceValues[GETPTYPE(GETPCPT(move))]>=EvalPieceValues[GETPTYPE(GETPFROM(move))])
+    return false;
+  return (see(board, move)<0);
+}
+/* best material gain of side to move in qsearch, most valuable enemy
+   piece plus queen promotion if a pawn is on the 7th rank */
+static Score bestgain(Bitboard *board, bool stm)
+{
+  s32 type;
+  Score gain = 0;
+  Bitboard bbOwn   = (stm)?board[QBBBLACK]:(board[QBBP1]|board[QBBP2]|board[QBBP3])^board[QBBBLACK];
+  Bitboard bbEnemy = (board[QBBP1]|board[QBBP2]|board[QBBP3])^bbOwn;
+
+  for (type=QUEEN;type>=PAWN;type--)
+  {
+    if (type!=KING&&(bbEnemy&piecetypes(board, type)))
+    {
+      gain = EvalPieceValues[type];
+      break;
+    }
+  }
+  if (bbOwn&piecetypes(board, PAWN)&((stm)?BBRANK2:BBRANK7))
+    gain+= EvalPieceValues[QUEEN]-EvalPieceValues[PAWN];
+  return gain;
+}
+/* history bonus or malus, entries saturate towards +-HISTMAX */
+static void updatehistory(s16 *entry, s32 bonus)
+{
+  *entry+= (s16)(bonus-(s32)*entry*abs(bonus)/HISTMAX);
+}
+/* quiet move caused cutoff, update killers, counter move and histories,
+   quiet moves searched before get a malus */
+static void updatequiets(struct SearchContext *ctx, bool stm, s32 ply, s32 depth,
+                         Move lastmove, Move move,
+                         Move *quiets, s32 quietcount, Move ttmove)
+{
+  s32 i;
+  s32 bonus = MIN(depth*depth*32, HISTBONUSMAX);
+  bool cont = (JUSTMOVE(lastmove)!=MOVENONE&&JUSTMOVE(lastmove)!=NULLMOVE);
+
+  if (JUSTMOVE(ctx->killers[ply*2])!=JUSTMOVE(move))
+  {
+    ctx->killers[ply*2+1] = ctx->killers[ply*2];
+    ctx->killers[ply*2]   = JUSTMOVE(move);
+  }
+  ctx->counters[GETSQFROM(lastmove)*64+GETSQTO(lastmove)] = JUSTMOVE(move);
+
+  updatehistory(&ctx->history[HISTINDEX(stm, move)], bonus);
+  if (cont)
+    updatehistory(&ctx->conthistory[CONTHISTINDEX(lastmove, move)], bonus);
+  for (i=0;i<quietcount;i++)
+  {
+    if (JUSTMOVE(quiets[i])==JUSTMOVE(move)
+        ||JUSTMOVE(quiets[i])==JUSTMOVE(ttmove))
+      continue;
+    updatehistory(&ctx->history[HISTINDEX(stm, quiets[i])], -bonus);
+    if (cont)
+      updatehistory(&ctx->conthistory[CONTHISTINDEX(lastmove, quiets[i])], -bonus);
+  }
+}
+/* capture caused cutoff, captures searched before get a malus */
+static void updatecaptures(struct SearchContext *ctx, s32 depth, Move move,
+                           Move *capts, s32 captcount, Move ttmove)
+{
+  s32 i;
+  s32 bonus = MIN(depth*depth*32, HISTBONUSMAX);
+
+  if (GETPCPT(move)!=PNONE)
+    updatehistory(&ctx->capthistory[CAPTHISTINDEX(move)], bonus);
+  for (i=0;i<captcount;i++)
+  {
+    if (GETPCPT(capts[i])==PNONE
+        ||JUSTMOVE(capts[i])==JUSTMOVE(move)
+        ||JUSTMOVE(capts[i])==JUSTMOVE(ttmove))
+      continue;
+    updatehistory(&ctx->capthistory[CAPTHISTINDEX(capts[i])], -bonus);
+  }
+}
+/* perft, just node counting, returns leaf nodes */
+u64 perft(Bitboard *board, bool stm, s32 depth)
 {
-  bool kic = false;
   s32 i = 0;
   s32 movecounter = 0;
+  u64 nodes = 0;
   Cr cr = board[QBBPMVD];
   Move lastmove = board[QBBLAST];
   Hash hash = board[QBBHASH];
   Move moves[MAXMOVES];
 
-  kic = kingincheck(board, stm);
   /* leaf node, count */
   if (depth == 0)
-  {
-    NODECOUNT++;
-    return 0;
-  }
+    return 1;
+
   movecounter = genmoves_general(board, moves, movecounter, stm, false);
-  /* checkmate */
-  if (movecounter == 0 && kic)
-  {
-    return 0;
-  }
-  /* stalemate */
-  if (movecounter == 0 && !kic) 
-  {
-    return 0;
-  }
-  /* iterate through moves */
+  /* iterate through moves, checkmate and stalemate count nothing */
   for (i=0;i<movecounter;i++)
   {
     domove(board, moves[i]);
-    perft(board, !stm, depth-1);
+    nodes += perft(board, !stm, depth-1);
     undomove(board, moves[i], lastmove, cr, hash);
   }
-  return 0;
+  return nodes;
 }
 /* quiscence search */
-Score qsearch(Bitboard *board, 
-              bool stm, 
-              Score alpha, 
-              Score beta, 
-              s32 depth, 
+Score qsearch(struct SearchContext *ctx,
+              Bitboard *board,
+              bool stm,
+              Score alpha,
+              Score beta,
+              s32 depth,
               s32 ply)
 {
   bool kic = false;
+  u8 type = FAILLOW;
   Score score;
+  Score standpat;
   s32 i = 0;
   s32 movecounter = 0;
   Cr cr = board[QBBPMVD];
   Move lastmove = board[QBBLAST];
+  Move bestmove = MOVENONE;
+  Move ttmove = MOVENONE;
   Hash hash = board[QBBHASH];
+  struct TTE *tt = NULL;
+  struct TTE ttentry;
   Move moves[MAXMOVES];
 
-  /* time out? */
-/*
-  end = get_time();
-  elapsed = end-start;
-  if (elapsed>=MaxTime-TIMESPARE)
-  {
-    TIMEOUT=true;
-    return 0;
-  }
-*/
   /* check internal ply limit */
   if (ply>=MAXPLY)
   {
-    TIMEOUT=true;
+    ctx->timeout = true;
     return 0;
   }
 
-  NODECOUNT++;
+  ctx->nodecount++;
 
   /* check for K n k draw */
   if (popcount(board[QBBP1]|board[QBBP2]|board[QBBP3])<=2)
     return DRAWSCORE;
 
+  /* load transposition table, any entry is deep enough for qsearch,
+     cutoff on exact score or on bound outside of window */
+  tt = load_from_tt(ctx, hash, &ttentry);
+  if (tt
+      &&!ISINF(tt->score))
+  {
+    score = SCOREFROMTT(tt->score, ply);
+    if (tt->flag==EXACTSCORE
+        ||(tt->flag==FAILHIGH&&score>=beta)
+        ||(tt->flag==FAILLOW&&score<=alpha))
+    {
+      ctx->qsttcutoffs++;
+      if (tt->flag==EXACTSCORE)
+        ctx->ttstats.cutexact++;
+      else if (tt->flag==FAILHIGH)
+        ctx->ttstats.cutlower++;
+      else
+        ctx->ttstats.cutupper++;
+      return score;
+    }
+  }
+  if (tt
+      &&JUSTMOVE(tt->bestmove)!=MOVENONE)
+    ttmove = (Move)tt->bestmove;
+
   kic = kingincheck(board, stm);
 
-  /* get full eval score */
-  score = (stm)? -eval(board): eval(board);
+  /* get full eval score, via tt or eval cache */
+  if (tt&&tt->eval!=EVALNONE)
+    score = tt->eval;
+  else
+    score = (stm)? -evalcached(ctx, board): evalcached(ctx, board);
 
   /* stand pat */
   if(!kic&&score>=beta)
       return score;
   if(!kic&&score>alpha)
-      alpha = score;
+  {
+    alpha = score;
+    type  = EXACTSCORE;
+  }
+  standpat = score;
+
+  /* delta pruning, best possible gain can not reach alpha */
+  if (!kic
+      &&standpat+bestgain(board, stm)+DELTAMARGIN<alpha)
+  {
+    ctx->deltanodes++;
+    return alpha;
+  }
 
   movecounter = genmoves_promo(board, moves, movecounter, stm);
   movecounter = genmoves_captures(board, moves, movecounter, stm);
@@ -137,26 +544,69 @@ Score qsearch(Bitboard *board,
   if (movecounter==0)
     return score;
 
+  /* hash move first */
+  if (JUSTMOVE(ttmove)!=MOVENONE)
+  {
+    for (i=0;i<movecounter;i++)
+    {
+      if (JUSTMOVE(moves[i])==JUSTMOVE(ttmove))
+      {
+        ctx->qsttmoves++;
+        moves[i] = SETSCORE(moves[i], (Move)(Score)INF);
+        break;
+      }
+    }
+  }
+
   /* sort moves */
   qsort(moves, movecounter, sizeof(Move), cmp_move_desc);
 
   /* iterate through moves */
   for (i=0;i<movecounter;i++)
   {
+    /* delta pruning, captured piece can not raise score to alpha */
+    if (!kic
+        &&GETPTYPE(GETPTO(moves[i]))==GETPTYPE(GETPFROM(moves[i]))
+        &&standpat+EvalPieceValues[GETPTYPE(GETPCPT(moves[i]))]+DELTAMARGIN<=alpha)
+    {
+      ctx->deltaprunes++;
+      continue;
+    }
+    /* skip captures losing material */
+    if (!kic
+        &&GETPCPT(moves[i])!=PNONE
+        &&seelosing(board, moves[i]))
+    {
+      ctx->seeqsprunes++;
+      continue;
+    }
     domove(board, moves[i]);
-    score = -qsearch(board, !stm, -beta, -alpha, depth-1, ply+1);
+    score = -qsearch(ctx, board, !stm, -beta, -alpha, depth-1, ply+1);
     undomove(board, moves[i], lastmove, cr, hash);
 
     if(score>=beta)
+    {
+      save_to_tt(ctx, hash, (TTMove)(moves[i]&SMTTMOVE), SCORETOTT(score, ply),
+                 (kic)?EVALNONE:standpat, FAILHIGH, TTQSDEPTH);
       return score;
+    }
 
     if(score>alpha)
-      alpha=score;
+    {
+      alpha    = score;
+      bestmove = moves[i];
+      type     = EXACTSCORE;
+    }
   }
+  /* qsearch depth is below any search depth, depth replacement keeps
+     entries of main search, no store of -INF bound in check */
+  if (!ISINF(alpha))
+    save_to_tt(ctx, hash, (TTMove)(bestmove&SMTTMOVE), SCORETOTT(alpha, ply),
+               (kic)?EVALNONE:standpat, type, TTQSDEPTH);
   return alpha;
 }
 /* internal iterative deepening */
-Move iid(Bitboard *board, bool stm, Score alpha, Score beta, s32 depth, s32 ply)
+Move iid(struct SearchContext *ctx, Bitboard *board, bool stm, Score alpha, Score beta, s32 depth, s32 ply)
 {
   Score score = alpha;
   s32 i = 0;
@@ -168,7 +618,7 @@ Move iid(Bitboard *board, bool stm, Score alpha, Score beta, s32 depth, s32 ply)
   Move moves[MAXMOVES];
 
 
-  movecounter = genmoves(board, moves, 0, stm, false, 0);
+  movecounter = genmoves(ctx, board, moves, 0, stm, false, 0);
 
   if (movecounter<=1)
       return MOVENONE;
@@ -178,7 +628,20 @@ Move iid(Bitboard *board, bool stm, Score alpha, Score beta, s32 depth, s32 ply)
   {
 
     domove(board, moves[i]);
-    score = -negamax(board, !stm, -beta, -alpha, depth-1, ply+1, false);
+    /* principal variation search, zero window after first move */
+    if (i==0)
+      score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, false);
+    else
+    {
+      score = -negamax(ctx, board, !stm, -alpha-1, -alpha, depth-1, ply+1, false);
+      if (score>alpha
+          &&score<beta
+          &&!ctx->timeout)
+      {
+        ctx->pvsresearches++;
+        score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, false);
+      }
+    }
     undomove(board, moves[i], lastmove, cr, hash);
 
     if (score>=beta)
@@ -192,49 +655,483 @@ Move iid(Bitboard *board, bool stm, Score alpha, Score beta, s32 depth, s32 ply)
   }
   return bestmove;
 }
+/* search one capture or promotion, zero window after first move */
+static Score searchcapture(struct SearchContext *ctx,
+                           Bitboard *board,
+                           bool stm,
+                           Score alpha,
+                           Score beta,
+                           s32 depth,
+                           s32 ply,
+                           bool prune,
+                           s32 movesplayed,
+                           Move move)
+{
+  Score score;
+  Cr cr = board[QBBPMVD];
+  Move lastmove = board[QBBLAST];
+  Hash hash = board[QBBHASH];
+
+  domove(board, move);
+
+  /* principal variation search, zero window after first move */
+  if (movesplayed==0)
+    score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+  else
+  {
+    score = -negamax(ctx, board, !stm, -alpha-1, -alpha, depth-1, ply+1, prune);
+    if (score>alpha
+        &&score<beta
+        &&!ctx->timeout)
+    {
+      ctx->pvsresearches++;
+      score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+    }
+  }
+
+  undomove(board, move, lastmove, cr, hash);
+
+  return score;
+}
+/* search one quiet move with late move reductions */
+static Score searchquiet(struct SearchContext *ctx,
+                         Bitboard *board,
+                         bool stm,
+                         Score alpha,
+                         Score beta,
+                         s32 depth,
+                         s32 ply,
+                         bool prune,
+                         bool kic,
+                         bool ext,
+                         bool futile,
+                         s32 lmradjust,
+                         s32 lmplimit,
+                         s32 movesplayed,
+                         s32 quietsplayed,
+                         Move move,
+                         bool *pruned)
+{
+  bool childkic;
+  bool seeloss;
+  Score score;
+  s32 rdepth;
+  s32 r;
+  s32 hist;
+  Cr cr = board[QBBPMVD];
+  Move lastmove = board[QBBLAST];
+  Hash hash = board[QBBHASH];
+
+  *pruned = false;
+
+  /* history of move, for late move reductions */
+  hist = ctx->history[HISTINDEX(stm, move)];
+  if (JUSTMOVE(lastmove)!=MOVENONE&&JUSTMOVE(lastmove)!=NULLMOVE)
+    hist+= ctx->conthistory[CONTHISTINDEX(lastmove, move)];
+
+  /* see pruning, quiet moves losing material at low depth */
+  seeloss = (depth<=SEEDEPTH
+             &&!kic
+             &&!ext
+             &&movesplayed>0
+             &&!ISMATE(alpha)
+             &&see(board, move)<-SEEMARGIN*depth*depth);
+
+  domove(board, move);
+
+  childkic = kingincheck(board,!stm);
+
+  if (seeloss&&!childkic)
+  {
+    ctx->seeprunes++;
+    *pruned = true;
+    undomove(board, move, lastmove, cr, hash);
+    return alpha;
+  }
+
+  /* futility pruning, static eval of node plus margin below alpha */
+  if (futile
+      &&movesplayed>0
+      &&!childkic)
+  {
+    ctx->futilityprunes++;
+    *pruned = true;
+    undomove(board, move, lastmove, cr, hash);
+    return alpha;
+  }
+  /* late move pruning, quiet moves beyond count of node, but not those
+     giving check, killers, counters or moves with good history */
+  if (quietsplayed>=lmplimit
+      &&!childkic
+      &&(Score)GETSCORE(move)<INF-30
+      &&hist<LMPHIST)
+  {
+    ctx->lmpprunes[depth]++;
+    *pruned = true;
+    undomove(board, move, lastmove, cr, hash);
+    return alpha;
+  }
+  /* late move reductions, by table, less for pv nodes, improving nodes,
+     killers, counters and good history */
+  rdepth = depth;
+  if (!kic
+      &&!ext
+      &&depth>=2
+      &&movesplayed>=2
+      &&!childkic
+      &&popcount(board[QBBBLACK])>=2
+      &&popcount(board[QBBBLACK]^(board[QBBP1]|board[QBBP2]|board[QBBP3]))>=2
+     )
+  {
+    r = LmrTable[MIN(depth, LMRSIZE-1)][MIN(movesplayed, LMRSIZE-1)]+lmradjust;
+    r-= ((Score)GETSCORE(move)>=INF-30)?1:0;
+    r-= hist/(HISTMAX/2);
+    r = MAX(1, MIN(r, depth-1));
+    rdepth = depth-r;
+    ctx->lmrreductions++;
+    ctx->lmrplies+= r;
+  }
+
+  /* first move with full window */
+  if (movesplayed==0)
+    score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+  else
+  {
+    /* principal variation search, zero window for later moves */
+    score = -negamax(ctx, board, !stm, -alpha-1, -alpha, rdepth-1, ply+1, prune);
+
+    /* late move reductions, research with zero window */
+    if (rdepth!=depth&&
+        score>alpha)
+    {
+      ctx->lmrresearches++;
+      score = -negamax(ctx, board, !stm, -alpha-1, -alpha, depth-1, ply+1, prune);
+    }
+    /* fail high inside window, research with full window */
+    if (score>alpha
+        &&score<beta
+        &&!ctx->timeout)
+    {
+      ctx->pvsresearches++;
+      score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+    }
+  }
+
+  undomove(board, move, lastmove, cr, hash);
+
+  return score;
+}
+/* cutoff at split point or one of its parents */
+static bool splitcutoff(struct SplitPoint *sp)
+{
+  for (;sp;sp=sp->parent)
+  {
+    if (sp->cutoff)
+      return true;
+  }
+  return false;
+}
+/* cutoff at active split point or one of its parents */
+static bool splitaborted(struct SearchContext *ctx)
+{
+  return splitcutoff(ctx->activesplit);
+}
+/* search moves of split point until none left or cutoff, master and slaves */
+static void splitwork(struct SearchContext *ctx, struct SplitPoint *sp, Bitboard *board)
+{
+  bool pruned;
+  Score score;
+  Score alpha;
+  Move move;
+  s32 movesplayed;
+  s32 quietsplayed;
+  struct SplitPoint *active = ctx->activesplit;
+
+  ctx->activesplit = sp;
+  for (;;)
+  {
+    pthread_mutex_lock(&sp->lock);
+    if (sp->cutoff||sp->next>=sp->movecounter)
+    {
+      pthread_mutex_unlock(&sp->lock);
+      break;
+    }
+    move         = sp->moves[sp->next++];
+    movesplayed  = sp->movesplayed++;
+    quietsplayed = sp->quietsplayed++;
+    alpha        = sp->alpha;
+    pthread_mutex_unlock(&sp->lock);
+
+    score = searchquiet(ctx, board, sp->stm, alpha, sp->beta, sp->depth, sp->ply,
+                        sp->prune, sp->kic, sp->ext, sp->futile, sp->lmradjust, sp->lmplimit, movesplayed, quietsplayed, move, &pruned);
+
+    if (ctx->timeout)
+      break;
+
+    pthread_mutex_lock(&sp->lock);
+    if (!sp->cutoff&&score>sp->alpha)
+    {
+      sp->alpha     = score;
+      sp->bestmove  = move;
+      if (score>=sp->beta)
+        sp->cutoff  = true;
+    }
+    pthread_mutex_unlock(&sp->lock);
+  }
+  ctx->activesplit = active;
+  /* cutoff at this split point is no time out, at parents it is */
+  if (!*ctx->stop&&!splitaborted(ctx))
+    ctx->timeout = false;
+}
+/* split point with moves left, below master if given, smp lock is held,
+   only split points in use are locked, position is copied to ctx and
+   board while the split point is locked */
+static struct SplitPoint *splitfind(struct SearchContext *ctx, struct SplitPoint *master,
+                                    Bitboard *board)
+{
+  s32 i;
+  struct SplitPoint *sp;
+  struct SplitPoint *parent;
+
+  for (i=0;i<MAXSPLITS;i++)
+  {
+    sp = &ctx->smp->splits[i];
+    if (!sp->used||sp==master)
+      continue;
+    /* master helps only at split points of its own slaves */
+    for (parent=sp->parent;master&&parent&&parent!=master;parent=parent->parent);
+    if (master&&!parent)
+      continue;
+    pthread_mutex_lock(&sp->lock);
+    if (!sp->done&&sp->next<sp->movecounter&&!splitcutoff(sp))
+    {
+      sp->slaves++;
+      memcpy(board, sp->board, 8*sizeof(Bitboard));
+      memcpy(ctx->hashhistory, sp->hashes, (sp->gameply+sp->ply+1)*sizeof(Hash));
+      memcpy(ctx->evals, sp->evals, (sp->ply+1)*sizeof(Score));
+      ctx->ply        = sp->gameply;
+      ctx->nullminply = sp->nullminply;
+      ctx->nullcolor  = sp->nullcolor;
+      pthread_mutex_unlock(&sp->lock);
+      __sync_fetch_and_add(&ctx->smp->joincount, 1);
+      return sp;
+    }
+    pthread_mutex_unlock(&sp->lock);
+  }
+  return NULL;
+}
+/* search at split point found by splitfind as slave, then leave and wake
+   its master */
+static void splitjoin(struct SearchContext *ctx, struct SplitPoint *sp, Bitboard *board)
+{
+  initrepfilter(ctx);
+  splitwork(ctx, sp, board);
+
+  pthread_mutex_lock(&sp->lock);
+  sp->slaves--;
+  pthread_mutex_unlock(&sp->lock);
+  pthread_mutex_lock(&ctx->smp->lock);
+  pthread_cond_broadcast(&ctx->smp->work);
+  pthread_mutex_unlock(&ctx->smp->lock);
+}
+/* young brothers wait concept, share remaining moves of node with idle
+   threads, returns best score, bestmove is set on improvement */
+static Score split(struct SearchContext *ctx, Bitboard *board, bool stm,
+                   Score alpha, Score beta,
+                   s32 depth, s32 ply, bool prune, bool kic, bool ext,
+                   bool futile, s32 lmradjust, s32 lmplimit, Move *moves, s32 movecounter, Move ttmove,
+                   s32 movesplayed, s32 quietsplayed, Move *bestmove)
+{
+  bool pruned;
+  bool nullcolor = ctx->nullcolor;
+  s32 i;
+  s32 slaves;
+  s32 nullminply = ctx->nullminply;
+  Score score;
+  Bitboard childboard[8];
+  struct SMPState *smp = ctx->smp;
+  struct SplitPoint *sp = NULL;
+  struct SplitPoint *child;
+
+  /* get free split point */
+  pthread_mutex_lock(&smp->lock);
+  for (i=0;i<MAXSPLITS;i++)
+  {
+    if (!smp->splits[i].used)
+    {
+      sp = &smp->splits[i];
+      sp->used = true;
+      /* no work for slaves until filled */
+      sp->movecounter = 0;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&smp->lock);
+
+  /* none left, search serial */
+  if (!sp)
+  {
+    for (i=0;i<movecounter;i++)
+    {
+      if (ttmove&&JUSTMOVE(ttmove)==JUSTMOVE(moves[i]))
+        continue;
+      score = searchquiet(ctx, board, stm, alpha, beta, depth, ply, prune,
+                          kic, ext, futile, lmradjust, lmplimit, movesplayed++, quietsplayed++, moves[i], &pruned);
+      if (ctx->timeout)
+        return 0;
+      if (score>alpha)
+      {
+        alpha = score;
+        *bestmove = moves[i];
+        if (score>=beta)
+          break;
+      }
+    }
+    return alpha;
+  }
+
+  pthread_mutex_lock(&sp->lock);
+  memcpy(sp->board, board, 8*sizeof(Bitboard));
+  memcpy(sp->hashes, ctx->hashhistory, (ctx->ply+ply+1)*sizeof(Hash));
+  memcpy(sp->evals, ctx->evals, (ply+1)*sizeof(Score));
+  sp->parent      = ctx->activesplit;
+  sp->stm         = stm;
+  sp->prune       = prune;
+  sp->kic         = kic;
+  sp->ext         = ext;
+  sp->futile      = futile;
+  sp->lmradjust   = lmradjust;
+  sp->lmplimit    = lmplimit;
+  sp->depth       = depth;
+  sp->ply         = ply;
+  sp->gameply     = ctx->ply;
+  sp->nullminply  = ctx->nullminply;
+  sp->nullcolor   = ctx->nullcolor;
+  sp->alpha       = alpha;
+  sp->beta        = beta;
+  sp->cutoff      = false;
+  sp->done        = false;
+  sp->bestmove    = MOVENONE;
+  sp->movecounter = 0;
+  for (i=0;i<movecounter;i++)
+  {
+    if (ttmove&&JUSTMOVE(ttmove)==JUSTMOVE(moves[i]))
+      continue;
+    sp->moves[sp->movecounter++] = moves[i];
+  }
+  sp->next        = 0;
+  sp->movesplayed = movesplayed;
+  sp->quietsplayed = quietsplayed;
+  sp->slaves      = 0;
+  pthread_mutex_unlock(&sp->lock);
+  __sync_fetch_and_add(&smp->splitcount, 1);
+  pthread_mutex_lock(&smp->lock);
+  pthread_cond_broadcast(&smp->work);
+  pthread_mutex_unlock(&smp->lock);
+
+  /* master works too, then helps its slaves until they are done */
+  splitwork(ctx, sp, board);
+  /* close split point, moves may be left on time out or parent cutoff */
+  pthread_mutex_lock(&sp->lock);
+  sp->done = true;
+  pthread_mutex_unlock(&sp->lock);
+  pthread_mutex_lock(&smp->lock);
+  for (;;)
+  {
+    pthread_mutex_lock(&sp->lock);
+    slaves = sp->slaves;
+    pthread_mutex_unlock(&sp->lock);
+    if (!slaves)
+      break;
+    child = splitfind(ctx, sp, childboard);
+    if (child)
+    {
+      pthread_mutex_unlock(&smp->lock);
+      splitjoin(ctx, child, childboard);
+      ctx->nullminply = nullminply;
+      ctx->nullcolor  = nullcolor;
+      pthread_mutex_lock(&smp->lock);
+    }
+    else
+      pthread_cond_wait(&smp->work, &smp->lock);
+  }
+  pthread_mutex_unlock(&smp->lock);
+
+  if (sp->cutoff)
+    __sync_fetch_and_add(&smp->abortcount, 1);
+  score = sp->alpha;
+  if (sp->bestmove!=MOVENONE)
+    *bestmove = sp->bestmove;
+
+  pthread_mutex_lock(&smp->lock);
+  sp->used = false;
+  pthread_mutex_unlock(&smp->lock);
+
+  return score;
+}
 /* negamax, minimax with alpha-beta pruning and further extensions */
-Score negamax(Bitboard *board,
-              bool stm, 
-              Score alpha, 
-              Score beta, 
-              s32 depth, 
-              s32 ply, 
+Score negamax(struct SearchContext *ctx,
+              Bitboard *board,
+              bool stm,
+              Score alpha,
+              Score beta,
+              s32 depth,
+              s32 ply,
               bool prune)
 {
   bool kic = false;
   bool ext = false;
-  bool childkic;
+  bool futile = false;
+  bool pruned = false;
+  bool pvnode = (beta-alpha>1);
+  bool improving = false;
   u8 type = FAILLOW;
+  Score staticeval = EVALNONE;
   Score score = 0;
+  Score pcbeta;
   s32 hmc = (s32)GETHMC(board[QBBLAST]);
   s32 i = 0;
   s32 rdepth;
+  s32 lmradjust;
+  s32 lmplimit;
   s32 movecounter = 0;
   s32 movesplayed = 0;
+  s32 quietsplayed = 0;
+  s32 badcounter = 0;
+  s32 captcount = 0;
+  s32 quietcount = 0;
   s32 legalmovecounter = 0;
+  u64 nodes;
   Cr cr = board[QBBPMVD];
   Move lastmove = board[QBBLAST];
   Move bestmove = MOVENONE;
   Move ttmove = MOVENONE;
   Hash hash = board[QBBHASH];
   struct TTE *tt = NULL;
+  struct TTE ttentry;
   Move moves[MAXMOVES];
+  Move badcapts[MAXMOVES];
+  Move capts[MAXMOVES];     /* searched captures, for history malus */
+  Move quiets[MAXMOVES];    /* searched quiet moves, for history malus */
 
   kic = kingincheck(board, stm);
 
-  /* time out? */  
-  end = get_time();
-  elapsed = end-start;
-  if (elapsed>=MaxTime-TIMESPARE)
+  /* node limit? main thread decides and stops helper threads, time limit
+     is raised by timer thread */
+  if (ctx->id==0
+      &&ctx->maxnodes
+      &&ctx->nodecount>=ctx->maxnodes)
+    *ctx->stop = true;
+  if (*ctx->stop||(ctx->activesplit&&splitaborted(ctx)))
   {
-    TIMEOUT=true;
+    ctx->timeout = true;
     return 0;
   }
 
   /* check internal ply limit */
   if (ply>=MAXPLY)
   {
-    TIMEOUT=true;
+    ctx->timeout = true;
     return 0;
   }
 
@@ -246,12 +1143,35 @@ Score negamax(Bitboard *board,
   if (popcount(board[QBBP1]|board[QBBP2]|board[QBBP3])<=2)
     return DRAWSCORE;
 
-  HashHistory[PLY+ply] = hash;
+  /* hash history of ply, repetition filter counts new hash for old one */
+  ctx->repfilter[REPINDEX(ctx->hashhistory[ctx->ply+ply])]--;
+  ctx->repfilter[REPINDEX(hash)]++;
+  ctx->hashhistory[ctx->ply+ply] = hash;
 
-  /* check for repetition */
-  for (i=PLY+ply-2;i>=0&&i>=PLY+ply-hmc;i-=2)
-    if (HashHistory[i]==hash) 
-      return DRAWSCORE;
+  /* check for repetition, only if filter counts hash more than once */
+  if (ctx->repfilter[REPINDEX(hash)]>1)
+  {
+    ctx->repscans++;
+    for (i=ctx->ply+ply-2;i>=0&&i>=ctx->ply+ply-hmc;i-=2)
+      if (ctx->hashhistory[i]==hash)
+        return DRAWSCORE;
+  }
+  else
+    ctx->repskips++;
+
+  /* upcoming repetition, draw is lower bound */
+  if (alpha<DRAWSCORE
+      &&hmc>=3
+      &&upcomingrepetition(ctx, board, ply, hmc))
+  {
+    ctx->cuckoohits++;
+    alpha = DRAWSCORE;
+    if (alpha>=beta)
+    {
+      ctx->cuckoocutoffs++;
+      return alpha;
+    }
+  }
 
  	/* mate distance pruning
   alpha = (ISMATE(alpha))?MAX((-INF+ply), alpha):alpha;
@@ -268,76 +1188,240 @@ Score negamax(Bitboard *board,
     depth++;
     ext = true;
   }
-  
+
   /* call quiescence search */
   if (depth<=0)
-    return qsearch(board, stm, alpha, beta, depth, ply);
+    return qsearch(ctx, board, stm, alpha, beta, depth, ply);
 
-  NODECOUNT++;
+  ctx->nodecount++;
 
-  /* razoring */
-/*
-  evalscore = (stm)? -eval(board): eval(board);
-  if (!kic&&!ext&&depth==2)
+  /* load transposition table */
+  tt = load_from_tt(ctx, hash, &ttentry);
+
+  /* check transposition table score bounds, cutoff on exact score or
+     on bound outside of window, mate scores are relative to node */
+  if (tt
+      &&tt->hash==hash
+      &&(s32)tt->depth>=depth
+      &&!ISINF(tt->score)
+     )
   {
-    if (evalscore+EvalPieceValues[QUEEN]*2<alpha)
+    score = SCOREFROMTT(tt->score, ply);
+    if (tt->flag==EXACTSCORE)
     {
-      score = qsearch(board, stm, alpha, beta, 0, ply);
-      if (score<=alpha)
-        return score;
+      ctx->ttstats.cutexact++;
+      return score;
+    }
+    if (tt->flag==FAILHIGH&&score>=beta)
+    {
+      ctx->ttstats.cutlower++;
+      return score;
+    }
+    if (tt->flag==FAILLOW&&score<=alpha)
+    {
+      ctx->ttstats.cutupper++;
+      return score;
+    }
+  }
+
+  /* static eval of node, once, via tt or eval cache */
+  if (!kic)
+  {
+    if (tt&&tt->hash==hash&&tt->eval!=EVALNONE)
+      staticeval = tt->eval;
+    else
+      staticeval = (stm)? -evalcached(ctx, board): evalcached(ctx, board);
+  }
+  /* improving, static eval above the one of last own move */
+  ctx->evals[ply] = staticeval;
+  improving = (ply>=2
+               &&staticeval!=EVALNONE
+               &&ctx->evals[ply-2]!=EVALNONE
+               &&staticeval>ctx->evals[ply-2]);
+
+  /* reverse futility pruning, static null move */
+  if (RFP
+      &&!pvnode
+      &&!kic
+      &&!ext
+      &&depth<=3
+      &&!ISMATE(beta)
+      &&staticeval-RfpMargins[depth]>=beta)
+  {
+    ctx->rfpcutoffs++;
+    return staticeval-RfpMargins[depth];
+  }
+
+  /* razoring, drop into quiescence search when far below alpha */
+  if (RAZORING
+      &&!pvnode
+      &&!kic
+      &&!ext
+      &&depth<=3
+      &&!ISMATE(alpha)
+      &&staticeval+RazorMargins[depth]<=alpha)
+  {
+    ctx->razortries++;
+    score = qsearch(ctx, board, stm, alpha, alpha+1, 0, ply);
+    if (score<=alpha)
+    {
+      ctx->razorcutoffs++;
+      return score;
     }
   }
-*/
 
-  /* null move pruning, Bruce Moreland style */
-  rdepth = depth-2;
+  /* futility pruning of quiet moves, decided once per node */
+  futile = (FUTILITY
+            &&!pvnode
+            &&!kic
+            &&!ext
+            &&depth<=3
+            &&!ISMATE(alpha)
+            &&staticeval+FutilityMargins[depth]<=alpha);
+
+  /* null move pruning, reduction grows with depth and eval over beta, not
+     in pawn endgames of side to move because of zugzwang */
   if (prune
+      &&!pvnode
       &&!kic
       &&!ext
       &&JUSTMOVE(lastmove)!=NULLMOVE
-      &&depth>=4  // do not enter qsearch after nullmove
-      )
+      &&depth>=NULLDEPTH
+      &&(ply>=ctx->nullminply||stm!=ctx->nullcolor)
+      &&!ISMATE(beta)
+      &&staticeval>=beta
+      &&(((stm)?board[QBBBLACK]:(board[QBBP1]|board[QBBP2]|board[QBBP3])&~board[QBBBLACK])
+         &~(piecetypes(board, PAWN)|piecetypes(board, KING))))
   {
+    rdepth = 3+depth/6+MIN((staticeval-beta)/NULLMARGIN, 3);
+    /* do not enter qsearch after nullmove */
+    rdepth = MAX(depth-rdepth, 1);
+    ctx->nulltries++;
     donullmove(board);
-    score = -negamax(board, !stm, -beta, -beta+1, rdepth-1, ply+1, false);
+    score = -negamax(ctx, board, !stm, -beta, -beta+1, rdepth, ply+1, false);
     undonullmove(board, lastmove, hash);
-    if (score>=beta)
-      return score;
+    if (score>=beta&&!ctx->timeout)
+    {
+      /* verify at high depth, not nested, null move disabled for side to
+         move in the first plies of verification search, pruning stays on */
+      if (depth>=NULLVERIFY&&!ctx->nullminply)
+      {
+        ctx->nullverifies++;
+        ctx->nullminply = ply+3*rdepth/4;
+        ctx->nullcolor  = stm;
+        score = negamax(ctx, board, stm, beta-1, beta, rdepth, ply, prune);
+        ctx->nullminply = 0;
+        if (score<beta)
+          ctx->nullrefuted++;
+      }
+      /* no unproven mate scores from null search */
+      if (score>=beta)
+      {
+        ctx->nullcutoffs++;
+        return (ISMATE(score))?beta:score;
+      }
+    }
   }
 
-  /* load transposition table */
-  tt = load_from_tt(hash);
+  /* probcut, a good capture beating beta by margin at reduced depth will
+     most likely beat beta at full depth, not if tt denies it */
+  pcbeta = beta+PROBCUTMARGIN;
+  if (PROBCUT
+      &&prune
+      &&!pvnode
+      &&!kic
+      &&!ext
+      &&depth>=PROBCUTDEPTH
+      &&!ISMATE(beta)
+      &&!(tt
+          &&tt->hash==hash
+          &&(s32)tt->depth>=depth-PROBCUTR+1
+          &&!ISINF(tt->score)
+          &&SCOREFROMTT(tt->score, ply)<pcbeta))
+  {
+    movecounter = genmoves_promo(board, moves, 0, stm);
+    movecounter = genmoves_captures(board, moves, movecounter, stm);
+    movecounter = genmoves_enpassant(board, moves, movecounter, stm);
+    qsort(moves, movecounter, sizeof(Move), cmp_move_desc);
+    for (i=0;i<movecounter;i++)
+    {
+      /* exchange alone has to lift static eval over probcut beta */
+      if (see(board, moves[i])<pcbeta-staticeval)
+        continue;
+      ctx->probcuttries++;
+      domove(board, moves[i]);
+      /* quiescence pre-check, then reduced depth search */
+      score = -qsearch(ctx, board, !stm, -pcbeta, -pcbeta+1, 0, ply+1);
+      if (score>=pcbeta&&!ctx->timeout)
+      {
+        ctx->probcutsearches++;
+        score = -negamax(ctx, board, !stm, -pcbeta, -pcbeta+1, depth-PROBCUTR, ply+1, prune);
+      }
+      undomove(board, moves[i], lastmove, cr, hash);
+      if (ctx->timeout)
+        return 0;
+      if (score>=pcbeta)
+      {
+        ctx->probcutcutoffs++;
+        save_to_tt(ctx, hash, (TTMove)(moves[i]&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth-PROBCUTR+1);
+        return score;
+      }
+    }
+    movecounter = 0;
+  }
 
-  /* check transposition table score bounds */
-  if (tt
-      &&tt->hash==hash
-      &&(s32)tt->depth>depth
-      &&!ISINF(tt->score)
-      &&!ISMATE(tt->score)
-      &&!ISMATE(alpha)
-//      &&!ISDRAW(tt->score)
-     ) 
+  /* enhanced transposition cutoffs, probe tt for child positions */
+  if (ETC&&depth>=ETCDEPTH)
   {
-    if ((tt->flag==EXACTSCORE||tt->flag==FAILHIGH))
-      alpha = MAX(alpha, tt->score);
-    if (alpha >= beta) return alpha;
+    movecounter = genmoves_general(board, moves, 0, stm, false);
+    for (i=0;i<movecounter;i++)
+    {
+      ctx->etcprobes++;
+      tt = load_from_tt(ctx, hashmove(board, moves[i]), &ttentry);
+      /* child upper bound or exact score proves a cutoff */
+      if (tt
+          &&(s32)tt->depth>=depth-1
+          &&tt->flag!=FAILHIGH
+          &&!ISINF(tt->score)
+          &&-SCOREFROMTT(tt->score, ply+1)>=beta)
+      {
+        ctx->etccutoffs++;
+        score = -SCOREFROMTT(tt->score, ply+1);
+        if (prune)
+          save_to_tt(ctx, hash, (TTMove)(moves[i]&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth);
+        return score;
+      }
+    }
+    movecounter = 0;
+    /* reload tt entry of node */
+    tt = load_from_tt(ctx, hash, &ttentry);
   }
 
-  /* get tt move */
+  /* get tt move, upper bound entries keep move of former searches */
   if (tt
       &&tt->hash==hash
-      &&tt->flag>FAILLOW
-      &&JUSTMOVE(tt->bestmove)!=MOVENONE) 
+      &&JUSTMOVE(tt->bestmove)!=MOVENONE)
   {
     ttmove = ((Move)tt->bestmove)|(lastmove&SMHMC);
   }
 
+  /* internal iterative reductions, node without tt move is searched one
+     ply less, a former search of it was shallow or failed low */
+  if (IIR
+      &&JUSTMOVE(ttmove)==MOVENONE
+      &&depth>=IIRDEPTH)
+  {
+    ctx->iirreductions++;
+    depth--;
+  }
   /* internal iterative deepening, get a bestmove anyway */
-  if (JUSTMOVE(ttmove)==MOVENONE&&depth>5)
+  else if (JUSTMOVE(ttmove)==MOVENONE&&depth>=IIDDEPTH)
   {
-      ttmove = iid(board, stm, -INF, INF, depth/5, ply);
-      ttmove = (ttmove&CMHMC)|(lastmove&SMHMC);
-      TTHITS--;
+    ctx->iidsearches++;
+    nodes = ctx->nodecount;
+    ttmove = iid(ctx, board, stm, -INF, INF, depth/5, ply);
+    ttmove = (ttmove&CMHMC)|(lastmove&SMHMC);
+    ctx->iidnodes+= ctx->nodecount-nodes;
   }
 
   /* check tt move first */
@@ -346,13 +1430,12 @@ Score negamax(Bitboard *board,
       &&GETPCPT(ttmove)==GETPIECE(board,(GETSQCPT(ttmove)))
     )
   {
-    TTHITS++;
     domove(board, ttmove);
     if (isvalid(board))
     {
-      score = -negamax(board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+      score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, ply+1, prune);
 
-      if (TIMEOUT)
+      if (ctx->timeout)
       {
         undomove(board, ttmove, lastmove, cr, hash);
         return 0;
@@ -361,12 +1444,11 @@ Score negamax(Bitboard *board,
       if(score>=beta)
       {
         if (GETPCPT(ttmove)==PNONE&&prune)
-        {
-          Counters[GETSQFROM(lastmove)*64+GETSQTO(lastmove)] = JUSTMOVE(ttmove);
-          Killers[ply] = JUSTMOVE(ttmove);
-        }
+          updatequiets(ctx, stm, ply, depth, lastmove, ttmove, NULL, 0, MOVENONE);
+        if (GETPCPT(ttmove)!=PNONE&&prune)
+          updatecaptures(ctx, depth, ttmove, NULL, 0, MOVENONE);
         if (prune)
-          save_to_tt(hash, (TTMove)(ttmove&SMTTMOVE), score, FAILHIGH, depth);
+          save_to_tt(ctx, hash, (TTMove)(ttmove&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth);
         undomove(board, ttmove, lastmove, cr, hash);
 
         return score;
@@ -389,6 +1471,13 @@ Score negamax(Bitboard *board,
   movecounter = genmoves_enpassant(board, moves, movecounter, stm);
   legalmovecounter+= movecounter;
 
+  /* capture history, orders captures of same victim */
+  for (i=0;i<movecounter;i++)
+  {
+    if (GETPCPT(moves[i])!=PNONE)
+      moves[i] = SETSCORE(moves[i], (Move)(Score)((Score)GETSCORE(moves[i])+ctx->capthistory[CAPTHISTINDEX(moves[i])]/32));
+  }
+
   /* sort moves */
   qsort(moves, movecounter, sizeof(Move), cmp_move_desc);
 
@@ -399,19 +1488,27 @@ Score negamax(Bitboard *board,
         JUSTMOVE(ttmove)==JUSTMOVE(moves[i]))
       continue;
 
-    domove(board, moves[i]);
-
-    score = -negamax(board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+    /* captures losing material are searched after quiet moves */
+    if (seelosing(board, moves[i]))
+    {
+      ctx->badcaptures++;
+      badcapts[badcounter++] = moves[i];
+      continue;
+    }
 
-    undomove(board, moves[i], lastmove, cr, hash);
+    score = searchcapture(ctx, board, stm, alpha, beta, depth, ply, prune,
+                          movesplayed, moves[i]);
 
-    if (TIMEOUT)
+    if (ctx->timeout)
       return 0;
 
     if(score>=beta)
     {
       if (prune)
-        save_to_tt(hash, (TTMove)(moves[i]&SMTTMOVE), score, FAILHIGH, depth);
+      {
+        updatecaptures(ctx, depth, moves[i], capts, captcount, ttmove);
+        save_to_tt(ctx, hash, (TTMove)(moves[i]&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth);
+      }
       return score;
     }
 
@@ -421,11 +1518,23 @@ Score negamax(Bitboard *board,
       bestmove = moves[i];
       type = EXACTSCORE;
     }
+    capts[captcount++] = moves[i];
     movesplayed++;
   }
 
-  /* generate quiet moves */  
-  movecounter = genmoves_noncaptures(board, moves, 0, stm, ply);
+  /* late move reductions of node, less in pv, more if not improving */
+  lmradjust = ((pvnode)?-1:0)+((improving)?0:1);
+
+  /* late move pruning, quiet moves to search before the rest is skipped */
+  lmplimit = (LMP
+              &&!pvnode
+              &&!kic
+              &&!ext
+              &&depth<=LMPDEPTH
+              &&!ISMATE(alpha))?LmpCounts[improving][depth]:MAXMOVES;
+
+  /* generate quiet moves */
+  movecounter = genmoves_noncaptures(ctx, board, moves, 0, stm, ply);
   if (cr&SMCRALL)
     movecounter = genmoves_castles(board, moves, movecounter, stm);
   legalmovecounter+= movecounter;
@@ -433,10 +1542,6 @@ Score negamax(Bitboard *board,
   /* sort moves */
   qsort(moves, movecounter, sizeof(Move), cmp_move_desc);
 
-/*
-  evalscore = (stm)? -eval(board): eval(board);
-*/
-
   /* iterate through moves, noncaputres */
   for (i=0;i<movecounter;i++)
   {
@@ -444,60 +1549,79 @@ Score negamax(Bitboard *board,
         JUSTMOVE(ttmove)==JUSTMOVE(moves[i]))
       continue;
 
-    domove(board, moves[i]);
-
-    childkic = kingincheck(board,!stm);
-
-    /* futility pruning */
-/*
-    if (depth==1
-        &&!kic
-        &&!ext
-        &&movesplayed>0
-        &&!childkic
-        &&!(GETPTYPE(GETPFROM(moves[i]))==PAWN&&GETPTYPE(GETPTO(moves[i]))==QUEEN)
-        &&evalscore+EvalPieceValues[QUEEN]<alpha
-       )
+    /* young brothers wait, split remaining moves between idle threads */
+    if (ctx->smpmode==SMPYBWC
+        &&ctx->smp
+        &&ctx->smp->idle>0
+        &&depth>=SPLITDEPTH
+        &&movesplayed>=1
+        &&i<movecounter-1)
     {
-      undomove(board, moves[i], lastmove, cr, hash);
-      continue;
+      score = split(ctx, board, stm, alpha, beta, depth, ply, prune, kic, ext,
+                    futile, lmradjust, lmplimit, &moves[i], movecounter-i, ttmove, movesplayed, quietsplayed, &bestmove);
+      if (ctx->timeout)
+        return 0;
+      if (score>=beta)
+      {
+        if (prune)
+        {
+          updatequiets(ctx, stm, ply, depth, lastmove, bestmove, NULL, 0, MOVENONE);
+          save_to_tt(ctx, hash, (TTMove)(bestmove&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth);
+        }
+        return score;
+      }
+      if (score>alpha)
+      {
+        alpha = score;
+        type = EXACTSCORE;
+      }
+      break;
     }
-*/
-    /* late move reductions */
-    rdepth = depth;
-    if (!kic
-        &&!ext
-        &&depth>=2
-        &&movesplayed>=2
-        &&!childkic
-        &&popcount(board[QBBBLACK])>=2
-        &&popcount(board[QBBBLACK]^(board[QBBP1]|board[QBBP2]|board[QBBP3]))>=2
-       )
+
+    score = searchquiet(ctx, board, stm, alpha, beta, depth, ply, prune, kic, ext,
+                        futile, lmradjust, lmplimit, movesplayed, quietsplayed, moves[i], &pruned);
+
+    if (ctx->timeout)
+      return 0;
+
+    if(score>=beta)
     {
-      rdepth = depth-1;
+      if (prune)
+      {
+        updatequiets(ctx, stm, ply, depth, lastmove, moves[i], quiets, quietcount, ttmove);
+        save_to_tt(ctx, hash, (TTMove)(moves[i]&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth);
+      }
+      return score;
     }
 
-    score = -negamax(board, !stm, -beta, -alpha, rdepth-1, ply+1, prune);
-
-    /* late move reductions, research */
-    if (rdepth!=depth&&
-        score>alpha)
+    if(score>alpha)
     {
-      score = -negamax(board, !stm, -beta, -alpha, depth-1, ply+1, prune);
+      alpha=score;
+      bestmove = moves[i];
+      type = EXACTSCORE;
     }
+    /* moves pruned unsearched get no history malus */
+    if (!pruned)
+      quiets[quietcount++] = moves[i];
+    movesplayed++;
+    quietsplayed++;
+  }
 
-    undomove(board, moves[i], lastmove, cr, hash);
+  /* iterate through captures losing material */
+  for (i=0;i<badcounter;i++)
+  {
+    score = searchcapture(ctx, board, stm, alpha, beta, depth, ply, prune,
+                          movesplayed, badcapts[i]);
 
-    if (TIMEOUT)
+    if (ctx->timeout)
       return 0;
 
     if(score>=beta)
     {
       if (prune)
       {
-        Counters[GETSQFROM(lastmove)*64+GETSQTO(lastmove)] = JUSTMOVE(moves[i]);
-        Killers[ply] = JUSTMOVE(moves[i]);
-        save_to_tt(hash, (TTMove)(moves[i]&SMTTMOVE), score, FAILHIGH, depth);
+        updatecaptures(ctx, depth, badcapts[i], capts, captcount, ttmove);
+        save_to_tt(ctx, hash, (TTMove)(badcapts[i]&SMTTMOVE), SCORETOTT(score, ply), staticeval, FAILHIGH, depth);
       }
       return score;
     }
@@ -505,74 +1629,406 @@ Score negamax(Bitboard *board,
     if(score>alpha)
     {
       alpha=score;
-      bestmove = moves[i];
+      bestmove = badcapts[i];
       type = EXACTSCORE;
     }
+    capts[captcount++] = badcapts[i];
     movesplayed++;
   }
   /* checkmate */
   if (kic&&legalmovecounter==0)
     return -INF+ply;
   /* stalemate */
-  if (!kic&&legalmovecounter==0) 
+  if (!kic&&legalmovecounter==0)
     return STALEMATESCORE;
 
-  if (type>FAILLOW&&prune)
-    save_to_tt(hash, (TTMove)(bestmove&SMTTMOVE), alpha, type, depth);
+  /* store exact score or upper bound */
+  if (prune&&!ISINF(alpha))
+    save_to_tt(ctx, hash, (TTMove)(bestmove&SMTTMOVE), SCORETOTT(alpha, ply), staticeval, type, depth);
   return alpha;
 }
-Move rootsearch(Bitboard *board, bool stm, s32 depth)
+/* search root moves within window, one iteration, principal variation
+   search with zero window after first move, stops on fail high */
+static Score searchroot(struct SearchContext *ctx,
+                        Bitboard *board,
+                        bool stm,
+                        Move *moves,
+                        s32 movecounter,
+                        s32 depth,
+                        Score alpha,
+                        Score beta,
+                        Move *bestmove)
 {
-  bool kic = false;
   Score score;
+  s32 i;
+  Cr cr = board[QBBPMVD];
+  Move lastmove = board[QBBLAST];
+  Hash hash = board[QBBHASH];
+
+  for (i=0;i<movecounter;i++)
+  {
+    domove(board, moves[i]);
+
+    if (i==0)
+      score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, 1, true);
+    else
+    {
+      score = -negamax(ctx, board, !stm, -alpha-1, -alpha, depth-1, 1, true);
+      if (score>alpha
+          &&score<beta
+          &&!ctx->timeout)
+      {
+        ctx->pvsresearches++;
+        score = -negamax(ctx, board, !stm, -beta, -alpha, depth-1, 1, true);
+      }
+    }
+
+    undomove(board, moves[i], lastmove, cr, hash);
+
+    /* publish node count of lazy smp helper for main thread */
+    if (ctx->id&&ctx->smp)
+      ctx->smp->jobs[ctx->id].nodes = ctx->nodecount;
+
+    if (ctx->timeout)
+      break;
+
+    if(score>alpha)
+    {
+      alpha=score;
+      *bestmove = moves[i];
+      moves[i] = SETSCORE(moves[i],(Move)score);
+      /* fail high, aspiration window research */
+      if (alpha>=beta)
+        break;
+    }
+    else
+      moves[i] = SETSCORE(moves[i],(Move)(score-i));
+  }
+  return alpha;
+}
+/* lazy smp helper thread, silent iterative deepening on shared tt */
+static void *smphelper(void *arg)
+{
+  struct SMPJob *job = (struct SMPJob*)arg;
+  struct SearchContext *ctx = job->ctx;
+  s32 idf;
+  s32 i;
+  Move move;
+  Move bestmove = MOVENONE;
+
+  ctx->start = get_time();
+
+  /* vary move order, rotate root moves behind the best one */
+  for (i=0;i<ctx->id%MAX(1,job->movecounter-1);i++)
+  {
+    move = job->moves[1];
+    memmove(&job->moves[1], &job->moves[2], (job->movecounter-2)*sizeof(Move));
+    job->moves[job->movecounter-1] = move;
+  }
+  /* vary depths, odd threads skip first iteration */
+  for (idf=1+(ctx->id&1);idf<MAXPLY&&!ctx->timeout&&!*ctx->stop;idf++)
+  {
+    searchroot(ctx, ctx->board, ctx->stm, job->moves, job->movecounter, idf, -INF, INF, &bestmove);
+    job->nodes = ctx->nodecount;
+    if (!ctx->timeout)
+      qsort(job->moves, job->movecounter, sizeof(Move), cmp_move_desc);
+  }
+  job->nodes = ctx->nodecount;
+
+  return NULL;
+}
+/* ybwc worker thread, joins split points with work left */
+static void *ybwcworker(void *arg)
+{
+  struct SMPJob *job = (struct SMPJob*)arg;
+  struct SearchContext *ctx = job->ctx;
+  struct SMPState *smp = ctx->smp;
+  struct SplitPoint *sp;
+  Bitboard board[8];
+
+  /* idle until work found, sleep until a split point is created */
+  __sync_fetch_and_add(&smp->idle, 1);
+  pthread_mutex_lock(&smp->lock);
+  while (!*ctx->stop)
+  {
+    sp = splitfind(ctx, NULL, board);
+    if (!sp)
+    {
+      pthread_cond_wait(&smp->work, &smp->lock);
+      continue;
+    }
+    pthread_mutex_unlock(&smp->lock);
+    __sync_fetch_and_sub(&smp->idle, 1);
+
+    splitjoin(ctx, sp, board);
+    job->nodes = ctx->nodecount;
+
+    __sync_fetch_and_add(&smp->idle, 1);
+    pthread_mutex_lock(&smp->lock);
+  }
+  pthread_mutex_unlock(&smp->lock);
+  __sync_fetch_and_sub(&smp->idle, 1);
+  job->nodes = ctx->nodecount;
+
+  return NULL;
+}
+/* start smp helper threads on root position, lazy smp or ybwc workers */
+static void smpstart(struct SearchContext *ctx, Move *moves, s32 movecounter)
+{
+  s32 i;
+  struct SMPState *smp;
+  struct SearchContext *helper;
+
+  /* smp state is allocated on first use, kept for further searches */
+  if (!ctx->smp)
+  {
+    smp = (struct SMPState*)calloc(1, sizeof(struct SMPState));
+    if (!smp)
+      return;
+    pthread_mutex_init(&smp->lock, NULL);
+    pthread_cond_init(&smp->work, NULL);
+    for (i=0;i<MAXSPLITS;i++)
+      pthread_mutex_init(&smp->splits[i].lock, NULL);
+    ctx->smp = smp;
+  }
+  smp = ctx->smp;
+  smp->idle       = 0;
+  smp->splitcount = 0;
+  smp->joincount  = 0;
+  smp->abortcount = 0;
+
+  for (i=1;i<ctx->cores&&i<MAXTHREADS;i++)
+  {
+    smp->jobs[i].started  = false;
+    smp->jobs[i].nodes    = 0;
+    /* helpers get their own context, sharing tt, stop flag and smp state */
+    helper = createcontext(ctx->tt);
+    smp->jobs[i].ctx = helper;
+    if (!helper)
+      continue;
+    memcpy(helper->board, ctx->board, 8*sizeof(Bitboard));
+    memcpy(helper->hashhistory, ctx->hashhistory, (ctx->ply+1)*sizeof(Hash));
+    initrepfilter(helper);
+    helper->evals[0]  = EVALNONE;
+    helper->stm       = ctx->stm;
+    helper->ply       = ctx->ply;
+    helper->id        = i;
+    helper->maxtime   = ctx->maxtime;
+    helper->smpmode   = ctx->smpmode;
+    helper->stop      = ctx->stop;
+    helper->smp       = smp;
+    memcpy(smp->jobs[i].moves, moves, movecounter*sizeof(Move));
+    smp->jobs[i].movecounter  = movecounter;
+    smp->jobs[i].started      = (pthread_create(&smp->jobs[i].tid, NULL,
+                                                (ctx->smpmode==SMPYBWC)?ybwcworker:smphelper,
+                                                &smp->jobs[i])==0);
+  }
+}
+/* stop and join smp helper threads, release their contexts */
+static void smpstop(struct SearchContext *ctx)
+{
+  s32 i;
+
+  if (!ctx->smp)
+    return;
+  /* wake sleeping ybwc workers */
+  pthread_mutex_lock(&ctx->smp->lock);
+  *ctx->stop = true;
+  pthread_cond_broadcast(&ctx->smp->work);
+  pthread_mutex_unlock(&ctx->smp->lock);
+  for (i=1;i<ctx->cores&&i<MAXTHREADS;i++)
+  {
+    if (ctx->smp->jobs[i].started)
+      pthread_join(ctx->smp->jobs[i].tid, NULL);
+    ctx->smp->jobs[i].started = false;
+    /* smp state belongs to main context */
+    if (ctx->smp->jobs[i].ctx)
+      ctx->smp->jobs[i].ctx->smp = NULL;
+    releasecontext(ctx->smp->jobs[i].ctx);
+    ctx->smp->jobs[i].ctx = NULL;
+  }
+  *ctx->stop = false;
+}
+/* node count of all search threads */
+static u64 smpnodes(struct SearchContext *ctx)
+{
+  s32 i;
+  u64 nodes = ctx->nodecount;
+
+  if (!ctx->smp)
+    return nodes;
+  for (i=1;i<ctx->cores&&i<MAXTHREADS;i++)
+    nodes += ctx->smp->jobs[i].nodes;
+  return nodes;
+}
+/* print statistics of last search */
+static void printstats(struct SearchContext *ctx, FILE *file, s32 idf)
+{
+  u64 nodes = ctx->nodes;
+  double elapsed = ctx->elapsed;
+  s32 i;
+
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#%" PRIu64 " searched nodes in %lf seconds, with %" PRIu64 " tthits, ebf: %lf, nps: %" PRIu64 ", threads: %d\n", nodes, elapsed/1000, ctx->ttstats.hits, (double)pow(nodes, (double)1/idf), (u64)(nodes/(elapsed/1000)), ctx->cores);
+  printttstats(ctx, file);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#eval cache probes: %" PRIu64 ", hits: %" PRIu64 ", hit rate: %.1lf%%\n", ctx->evcprobes, ctx->evchits, (ctx->evcprobes)?(double)ctx->evchits*100/ctx->evcprobes:0.0);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#etc probes: %" PRIu64 ", cutoffs: %" PRIu64 "\n", ctx->etcprobes, ctx->etccutoffs);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#see qsearch prunes: %" PRIu64 ", quiet prunes: %" PRIu64 ", bad captures: %" PRIu64 "\n", ctx->seeqsprunes, ctx->seeprunes, ctx->badcaptures);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#delta prunes qsearch moves: %" PRIu64 ", nodes: %" PRIu64 "\n", ctx->deltaprunes, ctx->deltanodes);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#qsearch tt cutoffs: %" PRIu64 ", hash moves: %" PRIu64 "\n", ctx->qsttcutoffs, ctx->qsttmoves);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#rfp cutoffs: %" PRIu64 ", razoring tries: %" PRIu64 ", cutoffs: %" PRIu64 ", futility prunes: %" PRIu64 "\n", ctx->rfpcutoffs, ctx->razortries, ctx->razorcutoffs, ctx->futilityprunes);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#repetition scans: %" PRIu64 ", skipped by filter: %" PRIu64 ", upcoming repetitions: %" PRIu64 ", cutoffs: %" PRIu64 "\n", ctx->repscans, ctx->repskips, ctx->cuckoohits, ctx->cuckoocutoffs);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#iid searches: %" PRIu64 ", nodes: %" PRIu64 ", iir reductions: %" PRIu64 "\n", ctx->iidsearches, ctx->iidnodes, ctx->iirreductions);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#null move tries: %" PRIu64 ", cutoffs: %" PRIu64 ", verifications: %" PRIu64 ", refuted: %" PRIu64 "\n", ctx->nulltries, ctx->nullcutoffs, ctx->nullverifies, ctx->nullrefuted);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#probcut tries: %" PRIu64 ", searches: %" PRIu64 ", cutoffs: %" PRIu64 "\n", ctx->probcuttries, ctx->probcutsearches, ctx->probcutcutoffs);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#lmp prunes by depth 1-%d:", LMPDEPTH);
+  for (i=1;i<=LMPDEPTH;i++)
+    fprintf(file," %" PRIu64, ctx->lmpprunes[i]);
+  fprintf(file,"\n");
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#lmr reductions: %" PRIu64 ", avg plies: %.2lf, researches: %" PRIu64 "\n", ctx->lmrreductions, (ctx->lmrreductions)?(double)ctx->lmrplies/ctx->lmrreductions:0.0, ctx->lmrresearches);
+  if (file==LogFile)
+    fprintdate(file);
+  fprintf(file,"#pvs researches: %" PRIu64 ", aspiration fail low/high: %" PRIu64 "/%" PRIu64 "\n", ctx->pvsresearches, ctx->aspfaillow, ctx->aspfailhigh);
+  if (ctx->cores>1&&ctx->smpmode==SMPYBWC&&ctx->smp)
+  {
+    if (file==LogFile)
+      fprintdate(file);
+    fprintf(file,"#ybwc splits: %" PRIu64 ", joins: %" PRIu64 ", cutoffs: %" PRIu64 "\n", ctx->smp->splitcount, ctx->smp->joincount, ctx->smp->abortcount);
+  }
+}
+/* search root position of context within its limits, returns best move
+   and sets result fields of context */
+Move rootsearch(struct SearchContext *ctx)
+{
+  bool kic = false;
   Score alpha;
-  Score beta;
+  s32 lower;
+  s32 upper;
+  s32 delta;
   s32 xboard_score;
   s32 i = 0;
   s32 pvcount = 0;
   s32 idf = 1;
   s32 movecounter = 0;
+  Bitboard *board = ctx->board;
+  bool stm = ctx->stm;
   Hash hash = board[QBBHASH];
-  Cr cr = board[QBBPMVD];
   Move rootmove = MOVENONE;
   Move bestmove = MOVENONE;
-  Move lastmove = board[QBBLAST];
   struct TTE *tt = NULL;
+  struct TTE ttentry;
+  struct SearchTimer timer;
   Move moves[MAXMOVES];
   Move pvmoves[MAXMOVES];
 
-  TIMEOUT   = false;
-  NODECOUNT = 0;
-  MOVECOUNT = 0;
-  TTHITS    = 0;
-  COUNTERS1 = 0;
-  COUNTERS2 = 0;
-
-  start = get_time(); /* start timer */
-
-  HashHistory[PLY] = hash;
+  ctx->timeout    = false;
+  ctx->nodecount  = 0;
+  memset(&ctx->ttstats, 0, sizeof(struct TTStats));
+  ctx->evcprobes  = 0;
+  ctx->evchits    = 0;
+  ctx->etcprobes  = 0;
+  ctx->etccutoffs = 0;
+  ctx->seeqsprunes    = 0;
+  ctx->seeprunes      = 0;
+  ctx->badcaptures    = 0;
+  ctx->deltaprunes    = 0;
+  ctx->deltanodes     = 0;
+  ctx->qsttcutoffs    = 0;
+  ctx->qsttmoves      = 0;
+  ctx->rfpcutoffs     = 0;
+  ctx->razortries     = 0;
+  ctx->razorcutoffs   = 0;
+  ctx->futilityprunes = 0;
+  ctx->repskips       = 0;
+  ctx->repscans       = 0;
+  ctx->cuckoohits     = 0;
+  ctx->cuckoocutoffs  = 0;
+  ctx->iidsearches    = 0;
+  ctx->iidnodes       = 0;
+  ctx->iirreductions  = 0;
+  ctx->nulltries      = 0;
+  ctx->nullcutoffs    = 0;
+  ctx->nullverifies   = 0;
+  ctx->nullrefuted    = 0;
+  ctx->probcuttries    = 0;
+  ctx->probcutsearches = 0;
+  ctx->probcutcutoffs  = 0;
+  memset(ctx->lmpprunes, 0, sizeof(ctx->lmpprunes));
+  ctx->lmrreductions  = 0;
+  ctx->lmrplies       = 0;
+  ctx->lmrresearches  = 0;
+  ctx->pvsresearches  = 0;
+  ctx->aspfaillow     = 0;
+  ctx->aspfailhigh    = 0;
+  *ctx->stop      = false;
+  ctx->bestmove   = MOVENONE;
+  ctx->score      = 0;
+  ctx->depth      = 0;
+  ctx->nodes      = 0;
+  ctx->pvcount    = 0;
+  ctx->elapsed    = 0;
+
+  /* new search generation, for tt replacement */
+  if (ctx->ttaging)
+    newttgeneration(ctx->tt);
+  /* history of former searches counts half */
+  agehistory(ctx);
+
+  ctx->start = get_time(); /* start timer */
+
+  ctx->hashhistory[ctx->ply] = hash;
+  ctx->evals[0] = EVALNONE;
+  initrepfilter(ctx);
 
   kic = kingincheck(board, stm);
-  movecounter = genmoves(board, moves, movecounter, stm, false, PLY);
+  movecounter = genmoves(ctx, board, moves, movecounter, stm, false, 0);
 
   /* checkmate and stalemate */
   if (movecounter==0&&kic)
     return MOVENONE;
-  if (movecounter==0&&!kic) 
+  if (movecounter==0&&!kic)
     return MOVENONE;
   /* check for bookmove */
-  rootmove = bookmove(board, stm);
+  rootmove = (ctx->book)?bookmove(board, stm):MOVENONE;
   for (i=0;i<movecounter;i++)
   {
     if (rootmove!=MOVENONE&&
         JUSTMOVE(rootmove)==JUSTMOVE(moves[i]))
+    {
+      ctx->bestmove = moves[i];
       return moves[i];
+    }
   }
   /* check transposition table */
-  tt = load_from_tt(hash);
+  tt = load_from_tt(ctx, hash, &ttentry);
   if (tt&&
       tt->hash==hash&&
-      tt->flag>FAILLOW) 
+      tt->flag>FAILLOW)
   {
     for(i=0;i<movecounter;i++)
     {
@@ -589,61 +2045,79 @@ Move rootsearch(Bitboard *board, bool stm, s32 depth)
   /* get a rootmove anyway*/
   rootmove = moves[0];
 
-  /* gui output */
-  if (!xboard_mode)
-      fprintf(stdout, "ply score time nodes pv\n");
+  /* timer thread sets stop flag when time is up */
+  if (!timerstart(&timer, ctx->start+ctx->maxtime-TIMESPARE, ctx->stop))
+    fprintf(stdout, "Error (timer thread failed, no time limit): go\n");
+
+  /* lazy smp, helper threads share the tt */
+  if (ctx->cores>1)
+    smpstart(ctx, moves, movecounter);
+
   /* iterative deepening framework */
   do {
 
-    alpha = -INF;
-    beta  =  INF;
-
-    /* iterate through moves */
-    for (i=0;i<movecounter;i++)
+    /* aspiration window around score of last iteration */
+    delta = ASPWINDOW;
+    lower = -INF;
+    upper =  INF;
+    if (idf>=ASPDEPTH&&!ISMATE(ctx->score))
     {
-      domove(board, moves[i]);
-
-      score = -negamax(board, !stm, -beta, -alpha, idf-1, 1, true);
-
-      undomove(board, moves[i], lastmove, cr, hash);
-
-      if(score>alpha)
+      lower = MAX(-INF, ctx->score-delta);
+      upper = MIN( INF, ctx->score+delta);
+    }
+    for (;;)
+    {
+      alpha = searchroot(ctx, board, stm, moves, movecounter, idf,
+                         (Score)lower, (Score)upper, &bestmove);
+      if (ctx->timeout)
+        break;
+      /* fail low or high, widen window and research */
+      delta*= 2;
+      if (alpha<=lower&&lower>-INF)
       {
-        alpha=score;
-        bestmove = moves[i];
-        moves[i] = SETSCORE(moves[i],(Move)score);
+        ctx->aspfaillow++;
+        lower = (delta>ASPMAX)?-INF:MAX(-INF, alpha-delta);
+      }
+      else if (alpha>=upper&&upper<INF)
+      {
+        ctx->aspfailhigh++;
+        upper = (delta>ASPMAX)?INF:MIN(INF, alpha+delta);
+        /* fail high move first */
+        qsort(moves, movecounter, sizeof(Move), cmp_move_desc);
       }
       else
-        moves[i] = SETSCORE(moves[i],(Move)(score-i));
-
-      if (TIMEOUT)
         break;
     }
 
-    end = get_time(); /* stop timer */
-    elapsed = end-start;
+    ctx->end = get_time(); /* stop timer */
+    ctx->elapsed = ctx->end-ctx->start;
 
-    if (!TIMEOUT)
+    if (!ctx->timeout)
     {
       rootmove = bestmove;
-      save_to_tt(hash, (TTMove)(rootmove&SMTTMOVE), alpha, EXACTSCORE, idf);
+      ctx->score = alpha;
+      ctx->depth = idf;
+      save_to_tt(ctx, hash, (TTMove)(rootmove&SMTTMOVE), alpha, EVALNONE, EXACTSCORE, idf);
       /* sort moves */
       qsort(moves, movecounter, sizeof(Move), cmp_move_desc);
+      /* principal variation */
+      pvcount = collect_pv_from_hash(ctx, board, hash, pvmoves, idf-1);
+      memcpy(ctx->pv, pvmoves, pvcount*sizeof(Move));
+      ctx->pvcount = pvcount;
     }
 
     /* gui output */
-    if (!TIMEOUT&&(xboard_post||!xboard_mode))
+    if (!ctx->timeout&&ctx->post)
     {
-      pvcount = collect_pv_from_hash(board, hash, pvmoves, idf-1);
       /* xboard mate scores */
       xboard_score = (s32)alpha;
       xboard_score = (alpha<=-MATESCORE)?-100000-(INF+alpha):xboard_score;
       xboard_score = (alpha>=MATESCORE)?100000-(-INF+alpha):xboard_score;
-      fprintf(stdout, "%d %d %d %" PRIu64 " ", idf, xboard_score, (s32)(elapsed/10), NODECOUNT);
+      fprintf(stdout, "%d %d %d %" PRIu64 " ", idf, xboard_score, (s32)(ctx->elapsed/10), smpnodes(ctx));
       if (LogFile)
       {
         fprintdate(LogFile);
-        fprintf(LogFile, "%d %d %d %" PRIu64 " ", idf, xboard_score, (s32)(elapsed/10), NODECOUNT);
+        fprintf(LogFile, "%d %d %d %" PRIu64 " ", idf, xboard_score, (s32)(ctx->elapsed/10), smpnodes(ctx));
       }
       for (i=0;i<pvcount;i++)
       {
@@ -655,19 +2129,29 @@ Move rootsearch(Bitboard *board, bool stm, s32 depth)
       fprintf(stdout, "\n");
       if (LogFile)
         fprintf(LogFile, "\n");
+      /* tt usage */
+      fprintf(stdout, "#hashfull %d tthits %" PRIu64 " ttcutoffs %" PRIu64 "\n", hashfull(ctx->tt), ctx->ttstats.hits, ctx->ttstats.cutexact+ctx->ttstats.cutlower+ctx->ttstats.cutupper);
+      if (LogFile)
+      {
+        fprintdate(LogFile);
+        fprintf(LogFile, "#hashfull %d tthits %" PRIu64 " ttcutoffs %" PRIu64 "\n", hashfull(ctx->tt), ctx->ttstats.hits, ctx->ttstats.cutexact+ctx->ttstats.cutlower+ctx->ttstats.cutupper);
+      }
     }
-  } while (++idf<=depth&&elapsed*2<MaxTime&&!TIMEOUT&&idf<MAXPLY);
+  } while (++idf<=ctx->maxdepth&&ctx->elapsed*2<ctx->maxtime&&!ctx->timeout&&idf<MAXPLY
+           &&!(ctx->maxnodes&&ctx->nodecount>=ctx->maxnodes));
+
+  timerstop(&timer);
+  if (ctx->cores>1)
+    smpstop(ctx);
+  ctx->nodes    = smpnodes(ctx);
+  ctx->bestmove = rootmove;
 
-  if ((!xboard_mode)||xboard_debug)
+  if (ctx->debug)
   {
-    fprintf(stdout,"#%" PRIu64 " searched nodes in %lf seconds, with %" PRIu64 " tthits, ebf: %lf, nps: %" PRIu64 " \n", NODECOUNT, elapsed/1000, TTHITS, (double)pow(NODECOUNT, (double)1/idf), (u64)(NODECOUNT/(elapsed/1000)));
+    printstats(ctx, stdout, idf);
     if (LogFile)
-    {
-      fprintdate(LogFile);
-      fprintf(LogFile,"#%" PRIu64 " searched nodes in %lf seconds, with %" PRIu64 " tthits, ebf: %lf, nps: %" PRIu64 " \n", NODECOUNT, elapsed/1000, TTHITS, (double)pow(NODECOUNT, (double)1/idf), (u64)(NODECOUNT/(elapsed/1000)));
-    }
+      printstats(ctx, LogFile, idf);
   }
 
   return rootmove;
 }
-
@@ -22,21 +22,35 @@
 #ifndef SEARCH_H_INCLUDED
 #define SEARCH_H_INCLUDED
 
-Score perft(Bitboard *board, bool stm, s32 depth);
-Move rootsearch(Bitboard *board, bool stm, s32 depth);
-Score negamax(Bitboard *board,
+#include "types.h"      /* custom types, board defs, data structures, macros */
+
+u64 perft(Bitboard *board, bool stm, s32 depth);
+struct SearchContext *createcontext(struct TTable *tt);
+void releasecontext(struct SearchContext *ctx);
+void clearcontext(struct SearchContext *ctx);
+Move rootsearch(struct SearchContext *ctx);
+Score negamax(struct SearchContext *ctx,
+              Bitboard *board,
               bool stm, 
               Score alpha, 
               Score beta, 
               s32 depth, 
               s32 ply, 
               bool prune);
-Score qsearch(Bitboard *board, 
+Score qsearch(struct SearchContext *ctx,
+              Bitboard *board, 
               bool stm, 
               Score alpha, 
               Score beta, 
               s32 depth, 
               s32 ply);
+Move iid(struct SearchContext *ctx,
+         Bitboard *board,
+         bool stm,
+         Score alpha,
+         Score beta,
+         s32 depth,
+         s32 ply);
 
 #endif /* SEARCH_H_INCLUDED */
 
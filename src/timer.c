@@ -19,17 +19,80 @@
   GNU General Public License for more details.
 */
 
+#define _POSIX_C_SOURCE 200809L // for clock_gettime
+
 #include <stdio.h>      // for file IO
 #include <string.h>     // for string comparing functions
+#include <errno.h>      // for ETIMEDOUT
 #include <time.h>       // for time measurement
-#include <sys/time.h>   // for gettimeofday
 
-// get time in milli seconds
+#include "timer.h"
+
+// get time in milli seconds, monotonic clock, not adjusted by ntp
 double get_time(void) 
 {
-  struct timeval t;
-  gettimeofday (&t, NULL);
-  return t.tv_sec*1000 + t.tv_usec/1000;
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec*1000.0 + t.tv_nsec/1000000.0;
+}
+// timer thread, sleeps until deadline or cancel, then raises flag
+static void *timerthread(void *arg)
+{
+  struct SearchTimer *timer = (struct SearchTimer*)arg;
+
+  pthread_mutex_lock(&timer->lock);
+  while (!timer->cancel)
+  {
+    if (pthread_cond_timedwait(&timer->cond, &timer->lock, &timer->deadline)==ETIMEDOUT)
+    {
+      *timer->flag = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&timer->lock);
+  return NULL;
+}
+// start timer, sets flag at given get_time value, returns false on failure
+bool timerstart(struct SearchTimer *timer, double deadline, volatile bool *flag)
+{
+  pthread_condattr_t attr;
+
+  timer->flag   = flag;
+  timer->cancel = false;
+  timer->deadline.tv_sec  = (time_t)(deadline/1000);
+  timer->deadline.tv_nsec = (long)((deadline-(double)timer->deadline.tv_sec*1000)*1000000);
+  if (timer->deadline.tv_nsec<0)
+    timer->deadline.tv_nsec = 0;
+  if (timer->deadline.tv_nsec>999999999)
+    timer->deadline.tv_nsec = 999999999;
+
+  pthread_mutex_init(&timer->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&timer->cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  timer->started = (pthread_create(&timer->tid, NULL, timerthread, timer)==0);
+  if (!timer->started)
+  {
+    pthread_cond_destroy(&timer->cond);
+    pthread_mutex_destroy(&timer->lock);
+  }
+  return timer->started;
+}
+// cancel timer before deadline and join its thread
+void timerstop(struct SearchTimer *timer)
+{
+  if (!timer->started)
+    return;
+  pthread_mutex_lock(&timer->lock);
+  timer->cancel = true;
+  pthread_cond_signal(&timer->cond);
+  pthread_mutex_unlock(&timer->lock);
+  pthread_join(timer->tid, NULL);
+  pthread_cond_destroy(&timer->cond);
+  pthread_mutex_destroy(&timer->lock);
+  timer->started = false;
 }
 void get_date_string(char *string)
 {
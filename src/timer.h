@@ -22,11 +22,26 @@
 #ifndef TIMER_H_INCLUDED
 #define TIMER_H_INCLUDED
 
+#include <stdio.h>      /* for FILE */
+#include <stdbool.h>    /* for bool */
 #include <string.h>     /* for string compare */ 
 #include <time.h>       /* for time measurent */
-#include <sys/time.h>   /* for gettimeofday */
+#include <pthread.h>    /* for timer thread */
+
+/* timer thread, raises a flag at deadline, for search time control */
+struct SearchTimer {
+  pthread_t tid;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  struct timespec deadline;   /* monotonic clock */
+  volatile bool *flag;        /* raised at deadline */
+  bool cancel;
+  bool started;
+};
 
 double get_time (void);
+bool timerstart(struct SearchTimer *timer, double deadline, volatile bool *flag);
+void timerstop(struct SearchTimer *timer);
 void get_time_string (char *string);
 void fprintdate(FILE *file);
 
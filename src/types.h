@@ -57,7 +57,6 @@ typedef u64             PieceType;
 typedef u64             Move;
 typedef u64             File;
 typedef u64             Rank;
-
 #define VERSION         "0310"
 /* quad bitboard array index definition */
 #define QBBBLACK  0     /* pieces white */
@@ -66,7 +65,7 @@ typedef u64             Rank;
 #define QBBP3     3     /* piece type third bit */
 #define QBBPMVD   4     /* piece moved flags, for castle rights */
 #define QBBHASH   5     /* 64 bit board Zobrist hash */
-#define QBBSCORE  6     /* 16 bit, signed board score , stored as u64 */
+#define QBBPHASH  6     /* 64 bit pawn Zobrist hash */
 #define QBBLAST   7     /* lastmove + ep target + halfmove clock + move score */
 /* move encoding 
    0  -  5  square from
@@ -89,6 +88,33 @@ typedef u64             Rank;
 #define MAXGAMEPLY  1024    /* max ply a game can reach */
 #define MAXMOVES    256     /* max amount of legal moves per position */
 #define TIMESPARE   100     /* 100 milliseconds spare */
+#define ETCDEPTH    3       /* min depth for enhanced transposition cutoffs */
+#define MAXTHREADS  64      /* max search threads, cores command */
+#define MAXSPLITS   (MAXTHREADS*8)  /* max ybwc split points */
+#define SPLITDEPTH  4       /* min depth for ybwc split points */
+#define SEEDEPTH    3       /* max depth for see pruning of quiet moves */
+#define SEEMARGIN   50      /* see pruning threshold, times depth squared */
+#define DELTAMARGIN 200     /* qsearch delta pruning safety margin */
+#define TTQSDEPTH   0       /* tt depth of qsearch entries */
+#define LMRSIZE     64      /* late move reduction table, depth and moves */
+#define REPSIZE     4096    /* hashed repetition filter, power of 2 */
+#define CUCKOOSIZE  8192    /* cuckoo table of reversible moves, power of 2 */
+#define PROBCUTDEPTH 5      /* min depth for probcut */
+#define PROBCUTR    4       /* probcut depth reduction */
+#define PROBCUTMARGIN 100   /* probcut margin over beta */
+#define LMPDEPTH    4       /* max depth for late move pruning */
+#define LMPHIST     (HISTMAX/4) /* history exempt from late move pruning */
+#define IIDDEPTH    6       /* min depth for internal iterative deepening */
+#define IIRDEPTH    4       /* min depth for internal iterative reductions */
+#define NULLDEPTH   3       /* min depth for null move pruning */
+#define NULLVERIFY  10      /* min depth for null move verification search */
+#define NULLMARGIN  200     /* eval over beta per additional null move ply */
+#define ASPDEPTH    4       /* min depth for aspiration windows */
+#define ASPWINDOW   100     /* initial aspiration window, doubled on fail */
+#define ASPMAX      400     /* full window when aspiration grows larger */
+/* smp modes */
+#define SMPLAZY     0       /* lazy smp, threads share tt only */
+#define SMPYBWC     1       /* young brothers wait, split points */
 /* colors */
 #define BLACK               1
 #define WHITE               0
@@ -219,14 +245,209 @@ enum Squares
   SQ_A7, SQ_B7, SQ_C7, SQ_D7, SQ_E7, SQ_F7, SQ_G7, SQ_H7,
   SQ_A8, SQ_B8, SQ_C8, SQ_D8, SQ_E8, SQ_F8, SQ_G8, SQ_H8
 };
-/* transposition table entry */
+/* transposition table entry, decoded */
 struct TTE {
         Hash hash;
         TTMove bestmove;
         Score score;
+        Score eval;     /* static eval, EVALNONE if not known */
         u8 flag;
         u8 depth;
 };
+/* transposition table slot, packed entry as stored in table */
+/* key:
+   0  -  7  depth
+   8  - 13  search generation
+  14  - 15  unused
+  16  - 63  upper bits of Zobrist hash, lower bits are given by the index
+   data:
+   0  - 29  move
+  30  - 31  node type flag
+  32  - 47  score, signed 16 bit
+  48  - 63  static eval, signed 16 bit
+   the key word is stored xored with the data word, a slot torn by
+   concurrent writers, threads or processes, fails the key compare
+*/
+struct TTSlot {
+        u64 key;
+        u64 data;
+};
+#define TTMINENTRIES        (1ULL<<16)          /* index covers key bits 0-15 */
+#define TTKEYMASK           0xFFFFFFFFFFFF0000ULL
+#define GETTTDEPTH(k)       ((k)&0xFF)          /* 8 bit depth */
+#define GETTTGEN(k)         (((k)>>8)&0x3F)     /* 6 bit search generation */
+#define MAKETTKEY(hash,depth,gen) \
+  (((hash)&TTKEYMASK)|((u64)(depth)&0xFF)|(((u64)(gen)&0x3F)<<8))
+#define GETTTMOVE(d)        ((TTMove)((d)&SMTTMOVE))
+#define GETTTFLAG(d)        ((u8)(((d)>>30)&0x3))
+#define GETTTSCORE(d)       ((Score)(((d)>>32)&0xFFFF))
+#define GETTTEVAL(d)        ((Score)(((d)>>48)&0xFFFF))
+#define TTSLOTKEY(k,d)      ((k)^(d))           /* stored <-> plain key */
+#define MAKETTDATA(move,flag,score,eval) \
+  (((u64)(move)&SMTTMOVE)|(((u64)(flag)&0x3)<<30) \
+  |(((u64)(score)&0xFFFF)<<32)|(((u64)(eval)&0xFFFF)<<48))
+/* eval cache, entry packs upper hash bits and eval into one word */
+#define EVCSIZE             (1ULL<<18)          /* eval cache entries */
+#define EVCKEYMASK          0xFFFFFFFFFFFF0000ULL
+/* no static eval stored */
+#define EVALNONE            (-INF-1)
+/* pawn hash table entry */
+#define PTSIZE          (1ULL<<16)      /* pawn hash table entries */
+struct PTE {
+        Hash hash;
+        Bitboard passed;    /* passed pawns, both colors */
+        Bitboard isolated;  /* isolated pawns, both colors */
+        Score score;        /* pawn structure score, white point of view */
+        u8 openfiles;       /* files without pawns, bit per file */
+        u8 halfopen[2];     /* files without own pawns, per color */
+};
+/* transposition table clear job, for parallel clear */
+#define MAXCLEARTHREADS 64
+struct TTClearJob {
+        struct TTSlot *tt;
+        u64 entries;
+};
+/* transposition table statistics, reset per search */
+struct TTStats {
+        u64 probes;     /* tt loads */
+        u64 hits;       /* tt loads with matching hash */
+        u64 collisions; /* tt loads, slot occupied by another position */
+        u64 cutexact;   /* cutoffs by exact score entries */
+        u64 cutlower;   /* cutoffs by lower bound, fail high, entries */
+        u64 cutupper;   /* cutoffs by upper bound, fail low, entries */
+        u64 stores;     /* tt saves */
+        u64 replempty;  /* saves into empty slot */
+        u64 replage;    /* saves replacing entry of older search */
+        u64 repldepth;  /* saves replacing entry of lower or same depth */
+};
+/* transposition table file header, for save and load of hash table */
+#define TTFILEMAGIC     0x5454415644415A5AULL /* "ZZADVATT" */
+#define TTFILEVERSION   3
+struct TTFileHeader {
+        u64 magic;      /* file magic, detects foreign files and endianess */
+        u64 version;    /* file format version, TTFILEVERSION */
+        u64 entrysize;  /* size of one entry, sizeof(struct TTSlot) */
+        u64 entries;    /* number of entries, power of two */
+        u64 mb;         /* hash size in mega bytes */
+        u64 generation; /* search generation at save */
+        u64 reserved[2];/* pad header to 64 bytes */
+};
+/* shared memory transposition table segment header, followed by slots */
+#define TTSHMMAGIC      0x4D48535444415A5AULL /* "ZZADTSHM" */
+#define TTSHMVERSION    1
+#define TTSHMWAIT       1000  /* milliseconds to wait for segment creator */
+#define TTSHMGENS       7     /* generations around own one counted as current */
+struct TTShmHeader {
+        u64 magic;      /* set by creator when segment is initialized */
+        u64 version;    /* segment format version, TTSHMVERSION */
+        u64 entrysize;  /* size of one entry, sizeof(struct TTSlot) */
+        u64 entries;    /* number of entries, power of two */
+        u64 mb;         /* hash size in mega bytes */
+        u64 generation; /* shared search generation, for tt replacement */
+        u64 attached;   /* number of attached processes */
+        u64 reserved;   /* pad header to 64 bytes */
+};
+/* transposition table, engine wide or private to a search context */
+struct TTable {
+        struct TTSlot *slots;
+        u64 entries;    /* number of slots, power of two */
+        u8 generation;  /* search generation, for aging of tt entries */
+        u8 genwindow;   /* generations around own one counted as current,
+                           for table shared with other processes */
+};
+/* smp state and split points, private to search */
+struct SMPState;
+struct SplitPoint;
+/* search context, holds all state of one search, contexts are independent
+   and can search concurrently, helper threads get their own context */
+struct SearchContext {
+        /* root position */
+        Bitboard board[8];
+        bool stm;
+        s32 ply;                /* game ply of root, index into hashhistory */
+        Hash *hashhistory;      /* game and search hashes, for repetitions */
+        u16 *repfilter;         /* count of hashhistory entries per hash slot */
+        /* move ordering and eval tables */
+        Move *killers;          /* killer move heuristic, two per ply */
+        Move *counters;         /* counter move heuristic */
+        s16 *history;           /* butterfly history, [stm][from][to] */
+        s16 *conthistory;       /* continuation history, [last piece][last to][piece][to] */
+        s16 *capthistory;       /* capture history, [piece][to][captured] */
+        struct PTE *pt;         /* pawn hash table */
+        Score evals[MAXPLY];    /* static eval per ply, for improving */
+        s32 nullminply;         /* no null move for nullcolor below this ply */
+        bool nullcolor;         /* side under null move verification */
+        struct TTable *tt;      /* transposition table, may be shared */
+        /* search limits */
+        s32 maxdepth;
+        double maxtime;         /* max time in milli-seconds */
+        u64 maxnodes;           /* max nodes of main thread, 0 for none */
+        s32 cores;              /* search threads */
+        s32 smpmode;            /* lazy smp or ybwc */
+        bool book;              /* probe opening book */
+        bool ttaging;           /* new tt generation per search, off if
+                                   the caller starts generations */
+        bool post;              /* print thinking output */
+        bool debug;             /* print search statistics */
+        /* timers */
+        double start;
+        double end;
+        double elapsed;
+        /* time control, stop flag is shared with helper threads */
+        bool timeout;
+        volatile bool stopflag;
+        volatile bool *stop;
+        /* smp */
+        s32 id;                 /* search thread id, main thread is 0 */
+        struct SMPState *smp;
+        struct SplitPoint *activesplit;
+        /* counters */
+        u64 nodecount;
+        struct TTStats ttstats;
+        u64 etcprobes;          /* enhanced transposition cutoff probes */
+        u64 etccutoffs;
+        u64 evcprobes;          /* eval cache probes */
+        u64 evchits;
+        u64 seeqsprunes;        /* losing captures skipped in qsearch */
+        u64 seeprunes;          /* losing quiet moves pruned */
+        u64 badcaptures;        /* losing captures searched after quiets */
+        u64 deltaprunes;        /* qsearch captures skipped by delta */
+        u64 deltanodes;         /* qsearch nodes cut by delta */
+        u64 qsttcutoffs;        /* qsearch tt bound cutoffs */
+        u64 qsttmoves;          /* qsearch hash moves searched first */
+        u64 rfpcutoffs;         /* reverse futility pruning cutoffs */
+        u64 razortries;         /* razoring qsearch probes */
+        u64 razorcutoffs;
+        u64 futilityprunes;     /* quiet moves pruned by futility */
+        u64 repskips;           /* repetition scans skipped by filter */
+        u64 repscans;
+        u64 cuckoohits;         /* upcoming repetitions, draw as lower bound */
+        u64 cuckoocutoffs;
+        u64 iidsearches;        /* internal iterative deepening searches */
+        u64 iidnodes;           /* nodes spent in iid */
+        u64 iirreductions;      /* nodes reduced by iir */
+        u64 nulltries;          /* null move searches */
+        u64 nullcutoffs;
+        u64 nullverifies;       /* verification searches of null cutoffs */
+        u64 nullrefuted;        /* cutoffs refuted by verification */
+        u64 probcuttries;       /* captures tried by probcut */
+        u64 probcutsearches;    /* reduced searches after qsearch pre-check */
+        u64 probcutcutoffs;
+        u64 lmpprunes[LMPDEPTH+1]; /* quiet moves pruned by move count, per depth */
+        u64 lmrreductions;      /* late move reductions */
+        u64 lmrplies;           /* plies reduced */
+        u64 lmrresearches;      /* reduced moves researched at full depth */
+        u64 pvsresearches;      /* zero window fail highs researched */
+        u64 aspfaillow;         /* aspiration window researches */
+        u64 aspfailhigh;
+        /* result of last search */
+        Move bestmove;
+        Score score;
+        s32 depth;
+        u64 nodes;              /* nodes of all search threads */
+        s32 pvcount;
+        Move pv[MAXPLY];
+};
 /* is score a draw, unprecise */
 #define ISDRAW(val) ((val==DRAWSCORE)?true:false)
 /* is score a mate in n */
@@ -235,6 +456,23 @@ struct TTE {
 /* is score default inf */
 #define ISINF(val) \
 (((val)==INF||(val)==-INF)?true:false)
+/* mate scores in tt are stored relative to node, not to root */
+#define SCORETOTT(val,ply) \
+(((val)>MATESCORE)?(val)+(ply):((val)<-MATESCORE)?(val)-(ply):(val))
+#define SCOREFROMTT(val,ply) \
+(((val)>MATESCORE)?(val)-(ply):((val)<-MATESCORE)?(val)+(ply):(val))
+/* history tables, entries are kept within +-HISTMAX */
+#define HISTMAX             16384
+#define HISTBONUSMAX        2048
+#define HISTSIZE            (2*64*64)
+#define CONTHISTSIZE        (8*64*8*64)
+#define CAPTHISTSIZE        (16*64*8)
+#define HISTINDEX(stm,mv) \
+((((stm)*64+GETSQFROM(mv))*64)+GETSQTO(mv))
+#define CONTHISTINDEX(lastmv,mv) \
+((((GETPTYPE(GETPTO(lastmv))*64+GETSQTO(lastmv))*8+GETPTYPE(GETPFROM(mv)))*64)+GETSQTO(mv))
+#define CAPTHISTINDEX(mv) \
+(((GETPFROM(mv)*64+GETSQTO(mv))*8)+GETPTYPE(GETPCPT(mv)))
 /* node type flags */
 #define FAILLOW         0
 #define EXACTSCORE      1
@@ -18,14 +18,26 @@
   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
   GNU General Public License for more details.
 */
+#define _POSIX_C_SOURCE 200809L /* for mmap and fileno */
+
 #include <stdio.h>      /* for print and scan */
 #include <stdlib.h>     /* for malloc free */
 #include <string.h>     /* for string compare */ 
 #include <getopt.h>     /* for getopt_long */
+#include <pthread.h>    /* for parallel hash table clear */
+#ifndef _WIN32
+#include <sys/mman.h>   /* for mmap of hash table files and shm_open */
+#include <sys/stat.h>   /* for fstat of shared memory segment and hash file */
+#include <fcntl.h>      /* for shm_open flags */
+#include <errno.h>      /* for shm_open errors */
+#include <time.h>       /* for nanosleep */
+#include <unistd.h>     /* for sysconf */
+#endif
 
 #include "book.h"       /* for polyglot book access */
 #include "bitboard.h"   /* for population count, pop_count */
 #include "eval.h"       /* for evalmove and eval */
+#include "libzetadva.h" /* for search contexts of epd batch workers */
 #include "movegen.h"    /* for move generator thingies */
 #include "search.h"     /* for search algorithms */
 #include "timer.h"      /* for time measurement */
@@ -36,12 +48,6 @@ FILE *LogFile = NULL;        /* logfile for debug */
 char *Line;                   /* for fgetting the input on stdin */
 char *Command;                /* for pasring the xboard command */
 char *Fen;                    /* for storing the fen chess baord string */
-/* counters */
-u64 NODECOUNT       = 0;
-u64 MOVECOUNT       = 0;
-u64 TTHITS          = 0;
-u64 COUNTERS1       = 0;
-u64 COUNTERS2       = 0;
 /* xboard flags */
 bool xboard_mode    = false;  /* chess GUI sets to true */
 bool xboard_force   = false;  /* if true aplly only moves, do not think */
@@ -50,11 +56,20 @@ bool xboard_san     = false;  /* use san move notation instead of can */
 bool xboard_time    = false;  /* use xboards time command for time management */
 bool xboard_debug   = false;  /* print debug information */
 u64 xboardmb        = 64;     /* mega bytes for hash table */
-/* timers */
-double start        = 0;
-double end          = 0;
-double elapsed      = 0;
-bool TIMEOUT        = false;  /* global value for time control*/
+s32 CORES           = 1;      /* search threads, xboard cores command */
+s32 SMPMODE         = SMPLAZY;/* smp mode, lazy or ybwc */
+/* search switches */
+bool ETC            = true;   /* enhanced transposition cutoffs */
+bool RFP            = true;   /* reverse futility pruning */
+bool FUTILITY       = true;   /* futility pruning of quiet moves */
+bool RAZORING       = true;   /* razoring into quiescence search */
+bool PROBCUT        = true;   /* probcut of cut nodes by good captures */
+bool LMP            = true;   /* late move pruning of quiet moves */
+bool IIR            = false;  /* internal iterative reductions instead of iid */
+/* timers, time used per game move */
+double start    = 0;
+double end      = 0;
+double elapsed  = 0;
 /* time control in milli-seconds */
 s32 timemode    = 0;  /* 0=single move, 1=conventional clock, 2=ics clock */
 s32 MovesLeft   = 1;  /* moves left unit nex time increase */
@@ -71,8 +86,8 @@ s32 PLY             = 0;     /* engine specifix ply counter */
 Move *MoveHistory;           /* last game moves indexed by ply */
 Hash *HashHistory;           /* last game hashes indexed by ply */
 Cr *CRHistory;             /* last board castle rights indexed by ply */
-Move *Killers;               /* killer move heuristic */
-Move *Counters;              /* counter move heuristic */
+/* search context of engine, search state, killers, counters, pawn table */
+struct SearchContext *SEARCHCTX = NULL;
 /* Quad Bitboard */
 /* based on http://chessprogramming.wikispaces.com/Quad-Bitboards */
 /* by Gerd Isenberg */
@@ -82,8 +97,9 @@ Bitboard BOARD[8];
   1   piece type first bit
   2   piece type second bit
   3   piece type third bit
-  5   piece moved flags, for castle rights
-  6   64 bit board Zobrist hash
+  4   piece moved flags, for castle rights
+  5   64 bit board Zobrist hash
+  6   64 bit pawn Zobrist hash
   7   lastmove + ep target + halfmove clock + move score
 */
 const Bitboard LRANK[2] =
@@ -93,17 +109,23 @@ const Bitboard LRANK[2] =
 };
 /* forward declarations */
 static void print_help(void);
+static Move think(void);
 static void print_version(void);
 static void selftest(void);
 static bool setboard(Bitboard *board, char *fenstring);
 static void createfen(char *fenstring, Bitboard *board, bool stm, s32 gameply);
-static void move2can(Move move, char *movec);
 static Move can2move(char *usermove, Bitboard *board, bool stm);
 void printboard(Bitboard *board);
 void printbitboard(Bitboard board);
 /* transposition hash table */
-struct TTE *TT = NULL;
-u64 ttbits = 0;
+struct TTable TT;           /* engine wide table, slots and generation */
+void *TTMapped = NULL;      /* memory mapped hash table file, if loaded */
+u64 TTMappedSize = 0;
+struct TTShmHeader *TTShm = NULL; /* shared memory segment, if attached */
+u64 TTShmSize = 0;
+char TTShmName[256];
+/* eval cache */
+u64 *EvalCache = NULL;
 /* rotate left based zobrist hashing */
 const Hash Zobrist[17]=
 {
@@ -118,6 +140,46 @@ const Hash Zobrist[17]=
   0x05D1A1AE85B49AA1
 };
 
+/* detach from shared memory hash table, last process removes segment */
+static void detachsharedTT(void)
+{
+#ifndef _WIN32
+  bool last;
+
+  if (!TTShm)
+    return;
+  last = (__sync_sub_and_fetch(&TTShm->attached, 1)==0);
+  munmap(TTShm, TTShmSize);
+  if (last)
+    shm_unlink(TTShmName);
+  TTShm     = NULL;
+  TTShmSize = 0;
+  TT.slots    = NULL;
+  TT.entries  = 0;
+  TT.genwindow = 0;
+#endif
+}
+/* release transposition table, allocated, memory mapped or shared */
+static void freeTT(void)
+{
+  if (TTShm)
+  {
+    detachsharedTT();
+    return;
+  }
+#ifndef _WIN32
+  if (TTMapped)
+  {
+    munmap(TTMapped, TTMappedSize);
+    TTMapped = NULL;
+    TTMappedSize = 0;
+    TT.slots = NULL;
+  }
+#endif
+  if (TT.slots)
+    free(TT.slots);
+  TT.slots = NULL;
+}
 /* release memory, files and tables */
 static bool release_inits(void)
 {
@@ -137,12 +199,10 @@ static bool release_inits(void)
     free(HashHistory);
   if (CRHistory) 
     free(CRHistory);
-  if (TT) 
-    free(TT);
-  if (Counters) 
-    free(Counters);
-  if (Killers) 
-    free(Killers);
+  freeTT();
+  releasecontext(SEARCHCTX);
+  if (EvalCache) 
+    free(EvalCache);
 
   bookclose();
 
@@ -195,68 +255,960 @@ Hash computehash(Bitboard *board, bool stm)
 
   return hash;
 }
+/* compute zobrist pawn hash from position */
+Hash computepawnhash(Bitboard *board)
+{
+  Piece piece;
+  Bitboard bbWork;
+  Square sq;
+  Hash hash = HASHNONE;
+  Hash zobrist;
+
+  bbWork = board[QBBP1]&~board[QBBP2]&~board[QBBP3];
+  /* for each pawn */
+  while(bbWork)
+  {
+    sq    = popfirst1(&bbWork);
+    piece = GETPIECE(board,sq);
+    zobrist = Zobrist[GETCOLOR(piece)*6+PAWN-1];
+    hash ^= ((zobrist<<sq)|(zobrist>>(64-sq))); /* rotate left 64 */
+  }
+  return hash;
+}
+/* zobrist hash of child position after move, without doing the move */
+Hash hashmove(Bitboard *board, Move move)
+{
+  Square sqfrom   = GETSQFROM(move);
+  Square sqto     = GETSQTO(move);
+  Square sqcpt    = GETSQCPT(move);
+  Square sqep;
+  Piece pfrom     = GETPFROM(move);
+  Piece pto       = GETPTO(move);
+  Piece pcpt      = GETPCPT(move);
+  Cr cr           = board[QBBPMVD];
+  Hash hash       = board[QBBHASH];
+  Hash zobrist;
+
+  /* castle rights, clear old */
+  if(((~cr)&SMCRWHITEK)==SMCRWHITEK)
+    hash ^= Zobrist[12];
+  if(((~cr)&SMCRWHITEQ)==SMCRWHITEQ)
+    hash ^= Zobrist[13];
+  if(((~cr)&SMCRBLACKK)==SMCRBLACKK)
+    hash ^= Zobrist[14];
+  if(((~cr)&SMCRBLACKQ)==SMCRBLACKQ)
+    hash ^= Zobrist[15];
+  /* file en passant, clear old */
+  sqep = GETSQEP(board[QBBLAST]);
+  if (sqep)
+  {
+    zobrist = Zobrist[16];
+    hash ^= ((zobrist<<GETFILE(sqep))|(zobrist>>(64-GETFILE(sqep))));
+  }
+  /* piece moved flags */
+  cr |= SETMASKBB(sqfrom)|SETMASKBB(sqto)|SETMASKBB(sqcpt);
+  /* castle rook */
+  if (GETPTYPE(pfrom)==KING&&(sqfrom-sqto==2||sqto-sqfrom==2))
+  {
+    zobrist = Zobrist[GETCOLOR(pfrom)*6+ROOK-1];
+    /* queenside */
+    if (sqfrom-sqto==2)
+    {
+      cr   |= SETMASKBB(sqfrom-4);
+      hash ^= ((zobrist<<(sqfrom-4))|(zobrist>>(64-(sqfrom-4))));
+      hash ^= ((zobrist<<(sqto+1))|(zobrist>>(64-(sqto+1))));
+    }
+    /* kingside */
+    else
+    {
+      cr   |= SETMASKBB(sqfrom+3);
+      hash ^= ((zobrist<<(sqfrom+3))|(zobrist>>(64-(sqfrom+3))));
+      hash ^= ((zobrist<<(sqto-1))|(zobrist>>(64-(sqto-1))));
+    }
+  }
+  /* clear piece from */
+  zobrist = Zobrist[GETCOLOR(pfrom)*6+GETPTYPE(pfrom)-1];
+  hash ^= ((zobrist<<(sqfrom))|(zobrist>>(64-(sqfrom))));
+  /* set piece to */
+  zobrist = Zobrist[GETCOLOR(pto)*6+GETPTYPE(pto)-1];
+  hash ^= ((zobrist<<(sqto))|(zobrist>>(64-(sqto))));
+  /* clear piece capture */
+  if (pcpt)
+  {
+    zobrist = Zobrist[GETCOLOR(pcpt)*6+GETPTYPE(pcpt)-1];
+    hash ^= ((zobrist<<(sqcpt))|(zobrist>>(64-(sqcpt))));
+  }
+  /* castle rights, set new */
+  if(((~cr)&SMCRWHITEK)==SMCRWHITEK)
+    hash ^= Zobrist[12];
+  if(((~cr)&SMCRWHITEQ)==SMCRWHITEQ)
+    hash ^= Zobrist[13];
+  if(((~cr)&SMCRBLACKK)==SMCRBLACKK)
+    hash ^= Zobrist[14];
+  if(((~cr)&SMCRBLACKQ)==SMCRBLACKQ)
+    hash ^= Zobrist[15];
+  /* file en passant, set new */
+  sqep = GETSQEP(move);
+  if (sqep)
+  {
+    zobrist = Zobrist[16];
+    hash ^= ((zobrist<<GETFILE(sqep))|(zobrist>>(64-GETFILE(sqep))));
+  }
+  /* color flipping */
+  hash ^= 0x1ULL;
+
+  return hash;
+}
+/* incremental pawn hash of move, applies to do and undo */
+static Hash pawnhashmove(Move move)
+{
+  Hash hash = HASHNONE;
+  Hash zobrist;
+  Square sq;
+
+  if (GETPTYPE(GETPFROM(move))==PAWN)
+  {
+    sq = GETSQFROM(move);
+    zobrist = Zobrist[GETCOLOR(GETPFROM(move))*6+PAWN-1];
+    hash ^= ((zobrist<<sq)|(zobrist>>(64-sq)));
+  }
+  if (GETPTYPE(GETPTO(move))==PAWN)
+  {
+    sq = GETSQTO(move);
+    zobrist = Zobrist[GETCOLOR(GETPTO(move))*6+PAWN-1];
+    hash ^= ((zobrist<<sq)|(zobrist>>(64-sq)));
+  }
+  if (GETPTYPE(GETPCPT(move))==PAWN)
+  {
+    sq = GETSQCPT(move);
+    zobrist = Zobrist[GETCOLOR(GETPCPT(move))*6+PAWN-1];
+    hash ^= ((zobrist<<sq)|(zobrist>>(64-sq)));
+  }
+  return hash;
+}
+/* get number of tt entries for given mega bytes, power of two */
+u64 ttentries(u64 mb)
+{
+  u64 mem = (mb*1024*1024)/(sizeof(struct TTSlot));
+  u64 bits = 0;
+
+  while ( mem >>= 1)   /* get msb */
+    bits++;
+  return MAX(1ULL<<bits, TTMINENTRIES);
+}
+/* thread worker, clear part of transposition table */
+static void *clearTT_worker(void *arg)
+{
+  struct TTClearJob *job = (struct TTClearJob*)arg;
+
+  memset(job->tt, 0, job->entries*sizeof(struct TTSlot));
+
+  return NULL;
+}
+/* clear transposition table via multiple threads, pre-faults the pages */
+static void clearTT(struct TTSlot *tt, u64 entries)
+{
+  s32 i;
+  s32 threads = 1;
+  u64 chunk;
+  bool started[MAXCLEARTHREADS];
+  pthread_t tids[MAXCLEARTHREADS];
+  struct TTClearJob jobs[MAXCLEARTHREADS];
+
+#ifndef _WIN32
+  threads = (s32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  /* small tables are not worth the thread overhead */
+  if (entries*sizeof(struct TTSlot)<(64ULL*1024*1024))
+    threads = 1;
+  threads = MAX(1, MIN(threads, MAXCLEARTHREADS));
+  chunk = entries/threads;
+
+  for (i=0;i<threads;i++)
+  {
+    jobs[i].tt      = tt+i*chunk;
+    jobs[i].entries = (i==threads-1)?entries-i*chunk:chunk;
+  }
+  /* helper threads, fallback to caller thread on failure */
+  for (i=1;i<threads;i++)
+  {
+    started[i] = (pthread_create(&tids[i], NULL, clearTT_worker, &jobs[i])==0);
+    if (!started[i])
+      clearTT_worker(&jobs[i]);
+  }
+  clearTT_worker(&jobs[0]);
+  for (i=1;i<threads;i++)
+  {
+    if (started[i])
+      pthread_join(tids[i], NULL);
+  }
+}
 /* initialize transposition and furter tables */
 static void initTT(void) 
 {
-  u64 mem = (xboardmb*1024*1024)/(sizeof(struct TTE));
+  u64 mem = ttentries(xboardmb);
 
-  ttbits = 0;
-  while ( mem >>= 1)   /* get msb */
-    ttbits++;
-  mem = 1ULL<<ttbits;   /* get number of tt entries */
-  ttbits=mem;
-  if (TT)
-    free(TT);
-  TT = (struct TTE*)calloc(mem,sizeof(struct TTE));
-  if (!TT)
+  /* shared table is used by other processes, keep contents */
+  if (!TTShm)
+  {
+    /* reuse already allocated table of same size */
+    if (!TT.slots||TTMapped||mem!=TT.entries)
+    {
+      freeTT();
+      TT.entries = mem;
+      TT.slots = (struct TTSlot*)malloc(mem*sizeof(struct TTSlot));
+    }
+    if (!TT.slots)
+      fprintf(stdout,"Error (hash table memory allocation, %" PRIu64" mb, failed): memory", xboardmb);
+    else
+      clearTT(TT.slots, TT.entries);
+  }
+  if (SEARCHCTX)
+    clearcontext(SEARCHCTX);
+}
+/* resize transposition table, rehash entries into new table */
+static void resizeTT(void)
+{
+  u64 i;
+  u64 mem = ttentries(xboardmb);
+  u64 key;
+  u64 slotkey;
+  Hash hash;
+  struct TTSlot *tt;
+  struct TTSlot *slot;
+
+  /* size of shared table is given by segment */
+  if (TTShm)
+    return;
+  if (!TT.slots)
+  {
+    initTT();
+    return;
+  }
+  if (mem==TT.entries)
+    return;
+
+  tt = (struct TTSlot*)malloc(mem*sizeof(struct TTSlot));
+  /* keep old table on failure */
+  if (!tt)
+  {
     fprintf(stdout,"Error (hash table memory allocation, %" PRIu64" mb, failed): memory", xboardmb);
-  if (Killers)
-    free(Killers);
-  Killers = (Move*)calloc(MAXPLY,sizeof(Move));
-  if (!Killers)
-    fprintf(stdout,"Error (Killers table memory allocation failed)");
-  if (Counters)
-    free(Counters);
-  Counters = (Move*)calloc(64*64,sizeof(Move));
-  if (!Counters)
-    fprintf(stdout,"Error (Counters table memory allocation failed)");
+    return;
+  }
+  clearTT(tt, mem);
+
+  /* rehash, prefer entries of current generation, then depth */
+  for (i=0;i<TT.entries;i++)
+  {
+    key = TTSLOTKEY(TT.slots[i].key, TT.slots[i].data);
+    if (key==HASHNONE)
+      continue;
+    /* restore lower hash bits from index */
+    hash = (key&TTKEYMASK)|(i&~TTKEYMASK);
+    slot = &tt[hash&(mem-1)];
+    slotkey = TTSLOTKEY(slot->key, slot->data);
+    if (slotkey==HASHNONE
+        ||(GETTTGEN(key)==TT.generation
+           &&GETTTGEN(slotkey)!=TT.generation)
+        ||(GETTTGEN(key)==GETTTGEN(slotkey)
+           &&GETTTDEPTH(key)>GETTTDEPTH(slotkey))
+       )
+    {
+      slot->data  = TT.slots[i].data;
+      slot->key   = TTSLOTKEY(MAKETTKEY(hash, GETTTDEPTH(key), GETTTGEN(key)), TT.slots[i].data);
+    }
+  }
+
+  freeTT();
+  TT.slots    = tt;
+  TT.entries  = mem;
+}
+/* entry of current search generation, or of a search of another process
+   on a shared table, whose generation counter moved on meanwhile */
+static bool ttcurrent(struct TTable *tt, u64 key)
+{
+  u8 age = (u8)((tt->generation-GETTTGEN(key))&0x3F);
+
+  return (age<=tt->genwindow||age>=64-tt->genwindow);
 }
 /* save entry to hash transposition table */
-void save_to_tt(Hash hash, TTMove move, Score score, u8 flag, s32 depth)
+void save_to_tt(struct SearchContext *ctx, Hash hash, TTMove move, Score score, Score eval, u8 flag, s32 depth)
 {
-  struct TTE *tete;
+  struct TTable *tt = ctx->tt;
+  struct TTSlot *slot;
+  u64 key;
+  u64 data;
 
   /* exit when timeout or no hash table */
-  if (TIMEOUT||!TT)
+  if (ctx->timeout||!tt||!tt->slots)
     return;
 
-  tete = &TT[hash&(ttbits-1)];
+  slot = &tt->slots[hash&(tt->entries-1)];
+  data = slot->data;
+  key  = TTSLOTKEY(slot->key, data);
+
+  ctx->ttstats.stores++;
 
-  /* depth replace */  
-  if ((u8)depth>=tete->depth)
+  /* depth replace, entries from older searches are always replaced */  
+  if ((u8)depth>=GETTTDEPTH(key)
+      ||!ttcurrent(tt, key))
   {
-    tete->hash      = hash;
-    tete->bestmove  = move;
-    tete->score     = score;
-    tete->flag      = flag;
-    tete->depth     = (u8)depth;
+    if (key==HASHNONE)
+      ctx->ttstats.replempty++;
+    else if (!ttcurrent(tt, key))
+      ctx->ttstats.replage++;
+    else
+      ctx->ttstats.repldepth++;
+
+    /* keep move of same position on upper bound store without move */
+    if (move==MOVENONE
+        &&(key&TTKEYMASK)==(hash&TTKEYMASK))
+      move = GETTTMOVE(data);
+
+    data        = MAKETTDATA(move, flag, score, eval);
+    slot->key   = TTSLOTKEY(MAKETTKEY(hash, (u8)depth, tt->generation), data);
+    slot->data  = data;
   }
 }
-/* load entry from via zobrist hash from transposition table */
-struct TTE *load_from_tt(Hash hash)
+/* load entry via zobrist hash from transposition table, decode into tete */
+struct TTE *load_from_tt(struct SearchContext *ctx, Hash hash, struct TTE *tete)
 {
-  struct TTE *tete;
+  struct TTable *tt = ctx->tt;
+  struct TTSlot *slot;
+  u64 key;
+  u64 data;
 
   /* exit when no hash table */
-  if (!TT)
+  if (!tt||!tt->slots)
     return NULL;
 
-  tete = &TT[hash&(ttbits-1)];
-  if (tete->hash==hash)
+  ctx->ttstats.probes++;
+
+  slot = &tt->slots[hash&(tt->entries-1)];
+  data = slot->data;
+  key  = TTSLOTKEY(slot->key, data);
+  if ((key&TTKEYMASK)==(hash&TTKEYMASK)&&key!=HASHNONE)
+  {
+    ctx->ttstats.hits++;
+    tete->hash      = hash;
+    tete->bestmove  = GETTTMOVE(data);
+    tete->score     = GETTTSCORE(data);
+    tete->eval      = GETTTEVAL(data);
+    tete->flag      = GETTTFLAG(data);
+    tete->depth     = (u8)GETTTDEPTH(key);
     return tete;
+  }
+  if (key!=HASHNONE)
+    ctx->ttstats.collisions++;
+
+  return NULL;
+}
+/* sampled fill ratio of transposition table in permille, current searches */
+s32 hashfull(struct TTable *tt)
+{
+  u64 i;
+  u64 key;
+  s32 used = 0;
+
+  if (!tt||!tt->slots)
+    return 0;
+
+  for (i=0;i<1000&&i<tt->entries;i++)
+  {
+    key = TTSLOTKEY(tt->slots[i].key, tt->slots[i].data);
+    if (key!=HASHNONE&&ttcurrent(tt, key))
+      used++;
+  }
+  return (tt->entries<1000)?(s32)(used*1000/tt->entries):used;
+}
+/* attach to named shared memory hash table, create if not present */
+static bool attachsharedTT(char *name)
+{
+#ifndef _WIN32
+  int fd;
+  bool creator = true;
+  s32 i;
+  u64 entries = ttentries(xboardmb);
+  u64 size = sizeof(struct TTShmHeader)+entries*sizeof(struct TTSlot);
+  struct stat st;
+  struct timespec wait = {0, 1000000};
+  struct TTShmHeader *header;
+  volatile u64 *magic;
+
+  if (strlen(name)>=sizeof(TTShmName))
+  {
+    fprintf(stdout,"Error (shared memory name too long): sharedhash\n");
+    return false;
+  }
+  fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0600);
+  if (fd<0&&errno==EEXIST)
+  {
+    creator = false;
+    fd = shm_open(name, O_RDWR, 0600);
+  }
+  if (fd<0)
+  {
+    fprintf(stdout,"Error (opening shared memory %s): sharedhash\n", name);
+    return false;
+  }
+  if (creator)
+  {
+    /* new segment is zero filled, an empty table */
+    if (ftruncate(fd, (off_t)size)!=0)
+    {
+      fprintf(stdout,"Error (sizing shared memory %s, %" PRIu64 " mb): sharedhash\n", name, xboardmb);
+      close(fd);
+      shm_unlink(name);
+      return false;
+    }
+  }
+  else
+  {
+    /* wait for creator to size segment */
+    for (i=0;i<TTSHMWAIT;i++)
+    {
+      if (fstat(fd, &st)==0&&(u64)st.st_size>=sizeof(struct TTShmHeader))
+        break;
+      nanosleep(&wait, NULL);
+    }
+    size = (i<TTSHMWAIT)?(u64)st.st_size:0;
+    if (size==0)
+    {
+      fprintf(stdout,"Error (shared memory %s not initialized): sharedhash\n", name);
+      close(fd);
+      return false;
+    }
+  }
+  header = (struct TTShmHeader*)mmap(NULL, size, PROT_READ|PROT_WRITE,
+                                     MAP_SHARED, fd, 0);
+  close(fd);
+  if ((void*)header==MAP_FAILED)
+  {
+    fprintf(stdout,"Error (mapping shared memory %s): sharedhash\n", name);
+    if (creator)
+      shm_unlink(name);
+    return false;
+  }
+  magic = &header->magic;
+  if (creator)
+  {
+    header->version     = TTSHMVERSION;
+    header->entrysize   = sizeof(struct TTSlot);
+    header->entries     = entries;
+    header->mb          = xboardmb;
+    header->generation  = TT.generation;
+    header->attached    = 0;
+    /* publish header, magic last */
+    __sync_synchronize();
+    *magic = TTSHMMAGIC;
+  }
+  else
+  {
+    for (i=0;i<TTSHMWAIT&&*magic!=TTSHMMAGIC;i++)
+      nanosleep(&wait, NULL);
+    __sync_synchronize();
+    /* reject foreign, stale or incompatible segments */
+    if (*magic!=TTSHMMAGIC
+        ||header->version!=TTSHMVERSION
+        ||header->entrysize!=sizeof(struct TTSlot)
+        ||header->entries<TTMINENTRIES
+        ||(header->entries&(header->entries-1))!=0
+        ||size!=sizeof(struct TTShmHeader)+header->entries*sizeof(struct TTSlot))
+    {
+      fprintf(stdout,"Error (incompatible shared memory %s): sharedhash\n", name);
+      munmap(header, size);
+      return false;
+    }
+  }
+  __sync_fetch_and_add(&header->attached, 1);
+
+  /* release own table, or detach from former segment */
+  freeTT();
+
+  TTShm         = header;
+  TTShmSize     = size;
+  TT.slots      = (struct TTSlot*)(header+1);
+  TT.entries    = header->entries;
+  xboardmb      = header->mb;
+  TT.generation = (u8)(header->generation&0x3F);
+  TT.genwindow  = TTSHMGENS;
+  strcpy(TTShmName, name);
+
+  return true;
+#else
+  fprintf(stdout,"Error (shared memory not supported on this platform): sharedhash %s\n", name);
+  return false;
+#endif
+}
+/* next search generation, shared between processes for shared table */
+void newttgeneration(struct TTable *tt)
+{
+  if (!tt)
+    return;
+  if (tt==&TT&&TTShm)
+    tt->generation = (u8)((__sync_add_and_fetch(&TTShm->generation, 1))&0x3F);
+  else
+    tt->generation = (tt->generation+1)&0x3F;
+}
+/* new game or position, keep table contents, entries of former searches
+   age by generation */
+static void ageTT(void)
+{
+  if (!TT.slots)
+  {
+    initTT();
+    return;
+  }
+  newttgeneration(&TT);
+  if (SEARCHCTX)
+    clearcontext(SEARCHCTX);
+}
+/* search game position via engine search context */
+static Move think(void)
+{
+  memcpy(SEARCHCTX->board, BOARD, 8*sizeof(Bitboard));
+  memcpy(SEARCHCTX->hashhistory, HashHistory, (PLY+1)*sizeof(Hash));
+  SEARCHCTX->stm      = STM;
+  SEARCHCTX->ply      = PLY;
+  SEARCHCTX->maxdepth = SD;
+  SEARCHCTX->maxtime  = MaxTime;
+  SEARCHCTX->cores    = CORES;
+  SEARCHCTX->smpmode  = SMPMODE;
+  SEARCHCTX->book     = true;
+  SEARCHCTX->post     = xboard_post||!xboard_mode;
+  SEARCHCTX->debug    = (!xboard_mode)||xboard_debug;
+
+  /* gui output */
+  if (!xboard_mode)
+    fprintf(stdout, "ply score time nodes pv\n");
+
+  return rootsearch(SEARCHCTX);
+}
+/* compare smp modes against one thread, time to depth and node overhead */
+static void smpbench(void)
+{
+  s32 cores = CORES;
+  s32 mode = SMPMODE;
+  s32 run;
+  double maxtime = MaxTime;
+  double times[3];
+  u64 nodes[3];
+  const char *names[3] = { "1 thread", "lazy", "ybwc" };
+
+  MaxTime = 24.0*60*60*1000;
+  for (run=0;run<3;run++)
+  {
+    CORES   = (run==0)?1:cores;
+    SMPMODE = (run==2)?SMPYBWC:SMPLAZY;
+    initTT();
+    think();
+    times[run] = MAX(SEARCHCTX->elapsed, 1);
+    nodes[run] = SEARCHCTX->nodes;
+  }
+  CORES   = cores;
+  SMPMODE = mode;
+  MaxTime = maxtime;
+
+  fprintf(stdout,"# smpbench depth %d, threads %d\n", SD, cores);
+  for (run=0;run<3;run++)
+  {
+    fprintf(stdout,"# %-8s nodes: %" PRIu64 ", time: %.3lf s, speedup: %.2lf, overhead: %.1lf%%\n",
+            names[run], nodes[run], times[run]/1000, times[0]/times[run],
+            ((double)nodes[run]/MAX(nodes[0],1)-1)*100);
+    if (LogFile)
+    {
+      fprintdate(LogFile);
+      fprintf(LogFile,"# %-8s nodes: %" PRIu64 ", time: %.3lf s, speedup: %.2lf, overhead: %.1lf%%\n",
+              names[run], nodes[run], times[run]/1000, times[0]/times[run],
+              ((double)nodes[run]/MAX(nodes[0],1)-1)*100);
+    }
+  }
+}
+/* epd batch analysis, positions are distributed over worker threads */
+struct EPDBatch {
+  pthread_mutex_t lock;   /* guards files, counters and pending lines */
+  FILE *in;
+  FILE *out;
+  u64 read;               /* positions read from input */
+  u64 written;            /* positions written, in input order */
+  char **pending;         /* analysed lines waiting for their turn */
+  u64 size;               /* size of pending */
+  s32 depth;              /* search limits per position, 0 for none */
+  u64 nodes;
+  double time;
+  u64 mb;                 /* private tt per worker, 0 for engine tt */
+  u64 searched;           /* nodes of all positions */
+  u64 errors;             /* lines without valid position */
+};
+/* analyse one epd line, returns line with analysis opcodes, caller frees */
+static char *epdanalyse(struct SearchContext *ctx, struct EPDBatch *batch,
+                        char *line, bool *valid)
+{
+  char fields[4][128];
+  char fen[1024];
+  char opcode[128];
+  char *out;
+  char *ops;
+  char *op;
+  char *end;
+  bool quoted;
+  s32 n = 0;
+  s32 len;
+  struct ZetadvaResult result;
+
+  *valid = false;
+  out = (char*)malloc(4096+MAXPLY*6);
+  if (!out)
+    return NULL;
+
+  /* keep lines without position as they are */
+  if (sscanf(line, "%127s %127s %127s %127s%n",
+             fields[0], fields[1], fields[2], fields[3], &n)!=4)
+  {
+    snprintf(out, 4096, "%s", line);
+    return out;
+  }
+  sprintf(fen, "%s %s %s %s", fields[0], fields[1], fields[2], fields[3]);
+  if (!zetadva_setfen(ctx, fen)
+      ||!zetadva_search(ctx, batch->depth, batch->nodes, batch->time))
+  {
+    snprintf(out, 4096, "%s", line);
+    return out;
+  }
+  *valid = true;
+  zetadva_result(ctx, &result);
+
+  /* analysis opcodes, moves in coordinate notation */
+  len = sprintf(out, "%s bm %s; ce %d;", fen, result.bestmove, result.score);
+  if (result.mate&&result.mateply>0)
+    len+= sprintf(out+len, " dm %d;", (result.mateply+1)/2);
+  len+= sprintf(out+len, " acd %d; acn %" PRIu64 "; acs %.0lf; pv %s;",
+                result.depth, result.nodes, result.time/1000, result.pv);
+
+  /* keep further opcodes of input, like id and comments */
+  ops = line+n;
+  while (*ops)
+  {
+    while (*ops==' '||*ops=='\t')
+      ops++;
+    if (*ops=='\0'||*ops=='\n'||*ops=='\r')
+      break;
+    /* operation ends at semicolon outside of quotes */
+    op = ops;
+    quoted = false;
+    for (end=op;*end&&*end!='\n'&&*end!='\r'&&(quoted||*end!=';');end++)
+      quoted = (*end=='"')?!quoted:quoted;
+    ops = (*end==';')?end+1:end;
+    if (sscanf(op, "%127s", opcode)!=1
+        ||!strcmp(opcode, "bm")||!strcmp(opcode, "ce")
+        ||!strcmp(opcode, "dm")||!strcmp(opcode, "acd")
+        ||!strcmp(opcode, "acn")||!strcmp(opcode, "acs")
+        ||!strcmp(opcode, "pv"))
+      continue;
+    if (len+(end-op)+3>=4096+MAXPLY*6)
+      break;
+    len+= sprintf(out+len, " %.*s;", (int)(end-op), op);
+  }
+  sprintf(out+len, "\n");
+
+  return out;
+}
+/* epd worker thread, own search context, engine tt or private tt */
+static void *epdworker(void *arg)
+{
+  struct EPDBatch *batch = (struct EPDBatch*)arg;
+  struct TTable *tt = (batch->mb)?zetadva_newtt(batch->mb):&TT;
+  struct SearchContext *ctx = (tt)?zetadva_create(tt):NULL;
+  char line[1024];
+  char *out;
+  char **pending;
+  bool valid;
+  u64 index;
+  u64 size;
+
+  if (!ctx)
+  {
+    fprintf(stdout,"Error (memory allocation failed): epdbatch worker\n");
+    if (tt&&tt!=&TT)
+      zetadva_freett(tt);
+    return NULL;
+  }
+  /* engine tt is shared by workers, generation is started once by batch,
+     so entries of concurrent positions are not aged */
+  ctx->ttaging = (tt!=&TT);
+  for (;;)
+  {
+    pthread_mutex_lock(&batch->lock);
+    if (!fgets(line, sizeof(line), batch->in))
+    {
+      pthread_mutex_unlock(&batch->lock);
+      break;
+    }
+    index = batch->read++;
+    pthread_mutex_unlock(&batch->lock);
+
+    out = epdanalyse(ctx, batch, line, &valid);
 
+    pthread_mutex_lock(&batch->lock);
+    batch->searched+= (valid)?ctx->nodes:0;
+    batch->errors+= (valid)?0:1;
+    /* grow pending lines */
+    if (index>=batch->size)
+    {
+      size = MAX(index+1, batch->size*2);
+      pending = (char**)realloc(batch->pending, size*sizeof(char*));
+      if (pending)
+      {
+        memset(pending+batch->size, 0, (size-batch->size)*sizeof(char*));
+        batch->pending = pending;
+        batch->size = size;
+      }
+    }
+    if (index<batch->size)
+      batch->pending[index] = (out)?out:strdup(line);
+    else
+    {
+      fprintf(stdout,"Error (memory allocation failed): epdbatch\n");
+      if (out)
+        free(out);
+    }
+    /* write finished lines in input order */
+    while (batch->written<batch->size&&batch->pending[batch->written])
+    {
+      fputs(batch->pending[batch->written], batch->out);
+      free(batch->pending[batch->written]);
+      batch->pending[batch->written++] = NULL;
+    }
+    pthread_mutex_unlock(&batch->lock);
+  }
+  zetadva_free(ctx);
+  if (tt!=&TT)
+    zetadva_freett(tt);
   return NULL;
 }
+/* analyse epd file with worker threads, write epd with analysis opcodes */
+static void epdbatch(char *args)
+{
+  char infile[1024];
+  char outfile[1024];
+  char key[64];
+  s32 threads = CORES;
+  s32 i;
+  s32 n = 0;
+  u64 value;
+  bool limits = false;
+  bool started[MAXTHREADS];
+  pthread_t tids[MAXTHREADS];
+  struct EPDBatch batch;
+
+  if (sscanf(args, "epdbatch %1023s %1023s%n", infile, outfile, &n)!=2)
+  {
+    fprintf(stdout,"Error (expected input and output file): epdbatch\n");
+    return;
+  }
+  memset(&batch, 0, sizeof(struct EPDBatch));
+  /* optional limits, without any the sd and st settings are used */
+  args+= n;
+  while (sscanf(args, "%63s %" SCNu64 "%n", key, &value, &n)==2)
+  {
+    args+= n;
+    if (!strcmp(key, "threads"))
+      threads = (s32)MAX(1, MIN(value, MAXTHREADS));
+    else if (!strcmp(key, "depth"))
+      batch.depth = (s32)MIN(value, MAXPLY-1);
+    else if (!strcmp(key, "nodes"))
+      batch.nodes = value;
+    else if (!strcmp(key, "time"))
+      batch.time = (double)value;
+    else if (!strcmp(key, "hash"))
+      batch.mb = value;
+    else
+    {
+      fprintf(stdout,"Error (unknown option %s): epdbatch\n", key);
+      return;
+    }
+    limits|= (!strcmp(key, "depth")||!strcmp(key, "nodes")||!strcmp(key, "time"));
+  }
+  if (!limits)
+  {
+    batch.depth = (SD<MAXPLY)?SD:0;
+    batch.time  = MaxTime;
+  }
+  batch.in = fopen(infile, "r");
+  if (!batch.in)
+  {
+    fprintf(stdout,"Error (can not open input file %s): epdbatch\n", infile);
+    return;
+  }
+  batch.out = fopen(outfile, "w");
+  if (!batch.out)
+  {
+    fprintf(stdout,"Error (can not open output file %s): epdbatch\n", outfile);
+    fclose(batch.in);
+    return;
+  }
+  pthread_mutex_init(&batch.lock, NULL);
+
+  /* one tt generation for whole batch on engine tt */
+  if (!batch.mb)
+    newttgeneration(&TT);
+
+  start = get_time();
+  for (i=0;i<threads;i++)
+    started[i] = (pthread_create(&tids[i], NULL, epdworker, &batch)==0);
+  for (i=0;i<threads;i++)
+  {
+    if (started[i])
+      pthread_join(tids[i], NULL);
+  }
+  end = get_time();
+  elapsed = MAX(end-start, 1);
+
+  /* lines left pending after failed workers */
+  for (i=0;(u64)i<batch.size;i++)
+  {
+    if (batch.pending[i])
+      free(batch.pending[i]);
+  }
+  if (batch.pending)
+    free(batch.pending);
+  pthread_mutex_destroy(&batch.lock);
+  fclose(batch.in);
+  fclose(batch.out);
+
+  fprintf(stdout,"# epdbatch %" PRIu64 " positions, %" PRIu64 " skipped, %" PRIu64 " nodes in %.3lf s, threads: %d, nps: %" PRIu64 ", positions/s: %.2lf\n",
+          batch.read-batch.errors, batch.errors, batch.searched, elapsed/1000, threads,
+          (u64)(batch.searched/(elapsed/1000)), (batch.read-batch.errors)/(elapsed/1000));
+  if (LogFile)
+  {
+    fprintdate(LogFile);
+    fprintf(LogFile,"# epdbatch %" PRIu64 " positions, %" PRIu64 " skipped, %" PRIu64 " nodes in %.3lf s, threads: %d, nps: %" PRIu64 ", positions/s: %.2lf\n",
+            batch.read-batch.errors, batch.errors, batch.searched, elapsed/1000, threads,
+            (u64)(batch.searched/(elapsed/1000)), (batch.read-batch.errors)/(elapsed/1000));
+  }
+}
+/* write transposition table with versioned header to file */
+static bool savehash(char *filename)
+{
+  FILE *file;
+  struct TTFileHeader header;
+
+  if (!TT.slots)
+  {
+    fprintf(stdout,"Error (no hash table allocated): savehash\n");
+    return false;
+  }
+  file = fopen(filename, "wb");
+  if (!file)
+  {
+    fprintf(stdout,"Error (opening file %s): savehash\n", filename);
+    return false;
+  }
+  memset(&header, 0, sizeof(struct TTFileHeader));
+  header.magic      = TTFILEMAGIC;
+  header.version    = TTFILEVERSION;
+  header.entrysize  = sizeof(struct TTSlot);
+  header.entries    = TT.entries;
+  header.mb         = xboardmb;
+  header.generation = TT.generation;
+
+  if (fwrite(&header, sizeof(struct TTFileHeader), 1, file)!=1
+      ||fwrite(TT.slots, sizeof(struct TTSlot), TT.entries, file)!=TT.entries)
+  {
+    fprintf(stdout,"Error (writing file %s): savehash\n", filename);
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+  return true;
+}
+/* read transposition table from file, via mmap if available */
+static bool loadhash(char *filename)
+{
+  FILE *file;
+  struct TTFileHeader header;
+  u64 filesize;
+  struct TTSlot *tt = NULL;
+#ifndef _WIN32
+  struct stat st;
+#endif
+
+  file = fopen(filename, "rb");
+  if (!file)
+  {
+    fprintf(stdout,"Error (opening file %s): loadhash\n", filename);
+    return false;
+  }
+  if (fread(&header, sizeof(struct TTFileHeader), 1, file)!=1)
+  {
+    fprintf(stdout,"Error (reading header of file %s): loadhash\n", filename);
+    fclose(file);
+    return false;
+  }
+  /* shared table is used by other processes */
+  if (TTShm)
+  {
+    fprintf(stdout,"Error (shared hash table attached): loadhash\n");
+    fclose(file);
+    return false;
+  }
+  /* 64 bit file size, long of ftell is 32 bit on windows */
+#ifdef _WIN32
+  _fseeki64(file, 0, SEEK_END);
+  filesize = (u64)_ftelli64(file);
+#else
+  filesize = (fstat(fileno(file), &st)==0)?(u64)st.st_size:0;
+#endif
+  /* reject foreign, stale or incompatible files */
+  if (header.magic!=TTFILEMAGIC
+      ||header.version!=TTFILEVERSION
+      ||header.entrysize!=sizeof(struct TTSlot)
+      ||header.entries<TTMINENTRIES
+      ||(header.entries&(header.entries-1))!=0
+      ||filesize!=sizeof(struct TTFileHeader)+header.entries*sizeof(struct TTSlot))
+  {
+    fprintf(stdout,"Error (incompatible hash file %s): loadhash\n", filename);
+    fclose(file);
+    return false;
+  }
+
+  freeTT();
+#ifndef _WIN32
+  /* private mapping, pages are loaded on demand and copied on write */
+  TTMapped = mmap(NULL, filesize, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                  fileno(file), 0);
+  if (TTMapped==MAP_FAILED)
+    TTMapped = NULL;
+  if (TTMapped)
+  {
+    TTMappedSize = filesize;
+    tt = (struct TTSlot*)((char*)TTMapped+sizeof(struct TTFileHeader));
+  }
+#endif
+  /* fallback, read file into memory */
+  if (!tt)
+  {
+    tt = (struct TTSlot*)malloc(header.entries*sizeof(struct TTSlot));
+    fseek(file, sizeof(struct TTFileHeader), SEEK_SET);
+    if (!tt||fread(tt, sizeof(struct TTSlot), header.entries, file)!=header.entries)
+    {
+      fprintf(stdout,"Error (reading hash table from file %s): loadhash\n", filename);
+      if (tt)
+        free(tt);
+      fclose(file);
+      initTT();
+      return false;
+    }
+  }
+  fclose(file);
+
+  TT.slots      = tt;
+  TT.entries    = header.entries;
+  xboardmb      = header.mb;
+  TT.generation = (u8)header.generation;
+
+  return true;
+}
 /* innitialize memory, files and tables */
 static bool inits(void)
 {
@@ -304,6 +1256,28 @@ static bool inits(void)
 
   bookopen();
 
+  /* eval cache, never stale, no clear on new game */
+  EvalCache = (u64 *)calloc(EVCSIZE, sizeof(u64));
+  if (!EvalCache) 
+  {
+    fprintf(stdout,"Error (memory allocation failed): u64 EvalCache[%" PRIu64 "]",
+            (u64)EVCSIZE);
+    return false;
+  }
+
+  /* search context of engine, killers, counters and pawn hash table */
+  SEARCHCTX = createcontext(&TT);
+  if (!SEARCHCTX)
+  {
+    fprintf(stdout,"Error (memory allocation failed): search context");
+    return false;
+  }
+
+  /* allocate and pre-fault hash table */
+  initTT();
+  if (!TT.slots)
+    return false;
+
 /* init pawn attack tables
   Square sq =0;
   Bitboard attacksw[64];
@@ -554,8 +1528,11 @@ void domove(Bitboard *board, Move move)
   zobrist = Zobrist[GETCOLOR(pto)*6+GETPTYPE(pto)-1];
   board[QBBHASH] ^= ((zobrist<<(sqto))|(zobrist>>(64-(sqto))));
   /* do hash increment, clear piece capture */
-  zobrist = Zobrist[GETCOLOR(pcpt)*6+GETPTYPE(pcpt)-1];
-  board[QBBHASH] ^= (pcpt)?((zobrist<<(sqcpt))|(zobrist>>(64-(sqcpt)))):BBEMPTY;
+  if (pcpt)
+  {
+    zobrist = Zobrist[GETCOLOR(pcpt)*6+GETPTYPE(pcpt)-1];
+    board[QBBHASH] ^= ((zobrist<<(sqcpt))|(zobrist>>(64-(sqcpt))));
+  }
   /* castle rights */
   if(((~board[QBBPMVD])&SMCRWHITEK)==SMCRWHITEK)
     board[QBBHASH] ^= Zobrist[12];
@@ -579,6 +1556,9 @@ void domove(Bitboard *board, Move move)
   /* color flipping */
   board[QBBHASH] ^= 0x1ULL;
 
+  /* do pawn hash increment */
+  board[QBBPHASH] ^= pawnhashmove(move);
+
   /* store hmc  */  
   move = SETHMC(move, hmc);
   /* store lastmove in board */
@@ -609,6 +1589,8 @@ void undomove(Bitboard *board,
   board[QBBPMVD] = cr;
   /* restore hash */
   board[QBBHASH] = hash;
+  /* restore pawn hash */
+  board[QBBPHASH] ^= pawnhashmove(move);
 
   /* unset square capture, square to */
   bbTemp = CLRMASKBB(sqcpt)&CLRMASKBB(sqto);
@@ -670,17 +1652,18 @@ void undomove(Bitboard *board,
   }
 }
 /* collect principal variaton from hash table for xboard output */
-s32 collect_pv_from_hash(Bitboard *board, Hash hash, Move *moves, s32 ply)
+s32 collect_pv_from_hash(struct SearchContext *ctx, Bitboard *board, Hash hash, Move *moves, s32 ply)
 {
   s32 i = 0;
   s32 count = 0;
   s32 repcount = 0;
   struct TTE *tt = NULL;
+  struct TTE ttentry;
   Cr cr[MAXMOVES];
   Hash hashes[MAXMOVES];
   Hash lastmoves[MAXMOVES];
 
-  tt = load_from_tt(hash);
+  tt = load_from_tt(ctx, hash, &ttentry);
   while (tt&&tt->hash==hash&&
          JUSTMOVE(tt->bestmove)!=MOVENONE&&i<MAXMOVES&&i<=ply&&i<MAXPLY)
   {
@@ -691,7 +1674,7 @@ s32 collect_pv_from_hash(Bitboard *board, Hash hash, Move *moves, s32 ply)
     moves[i++] = tt->bestmove;
     domove(board, tt->bestmove);
     hash = board[QBBHASH];
-    tt = load_from_tt(hash);
+    tt = load_from_tt(ctx, hash, &ttentry);
     /* check for repetition loop */
     for (count=i-1;count>=0;count--)
     {
@@ -885,7 +1868,7 @@ static Move can2move(char *usermove, Bitboard *board, bool stm)
   e1c1 => when king, indicates castle queenside  
   e7e8q => indicates pawn promotion to queen
 */
-static void move2can(Move move, char *movec) 
+void move2can(Move move, char *movec) 
 {
   char rankc[8] = "12345678";
   char filec[8] = "abcdefgh";
@@ -954,7 +1937,7 @@ void printboard(Bitboard *board)
 
   createfen (fenstring, BOARD, STM, GAMEPLY);
   fprintf(stdout,"#fen: %s\n",fenstring);
-  fprintf(stdout,"# eval score: %d\n",eval(BOARD));
+  fprintf(stdout,"# eval score: %d\n",eval(BOARD, SEARCHCTX->pt));
 
   if (LogFile)
   {
@@ -983,7 +1966,7 @@ void printboard(Bitboard *board)
     fprintf(LogFile, "###ABCDEFGH###\n");
     fprintdate(LogFile);
     fprintdate(LogFile);
-    fprintf(LogFile,"# eval score: %d\n",eval(BOARD));
+    fprintf(LogFile,"# eval score: %d\n",eval(BOARD, SEARCHCTX->pt));
 
     fflush (LogFile);
   }
@@ -1094,7 +2077,8 @@ static void createfen(char *fenstring, Bitboard *board, bool stm, s32 gameply)
   stringptr+=sprintf(stringptr, "%d", ((gameply+PLY)/2));
 }
 /* set internal chess board presentation to fen string */
-static bool setboard(Bitboard *board, char *fenstring)
+/* parse fen string into board, side to move and game ply, reentrant */
+bool parsefen(Bitboard *board, bool *stm, s32 *gameply, char *fenstring)
 {
   char tempchar;
   char *position; /* piece types and position, row_8, file_a, to row_1, file_h*/
@@ -1159,7 +2143,7 @@ static bool setboard(Bitboard *board, char *fenstring)
   board[QBBP3]    = 0x0ULL;
   board[QBBPMVD]  = BBFULL;
   board[QBBHASH]  = 0x0ULL;
-  board[QBBSCORE] = 0x0ULL;
+  board[QBBPHASH] = 0x0ULL;
   board[QBBLAST]  = 0x0ULL;
 
   /* parse piece types and position from fen string */
@@ -1212,10 +2196,10 @@ static bool setboard(Bitboard *board, char *fenstring)
     }
   }
   /* site to move */
-  STM = WHITE;
+  *stm = WHITE;
   if (cstm[0] == 'b' || cstm[0] == 'B')
   {
-    STM = BLACK;
+    *stm = BLACK;
   }
   /* castle rights */
   tempchar = castle[0];
@@ -1245,19 +2229,15 @@ static bool setboard(Bitboard *board, char *fenstring)
   /* store halfmovecounter into lastmove */
   lastmove = SETHMC(lastmove, hmc);
 
-  /* ply starts at zero */
-  PLY = 0;
   /* game ply can be more */
-  GAMEPLY = fendepth*2+STM;
+  *gameply = fendepth*2+*stm;
 
   /* compute zobrist hash */
-  board[QBBHASH] = computehash(BOARD, STM);
-  HashHistory[PLY] = board[QBBHASH];
+  board[QBBHASH] = computehash(board, *stm);
+  board[QBBPHASH] = computepawnhash(board);
 
   /* store lastmove+ in board */
   board[QBBLAST] = lastmove;
-  /* store lastmove+ in history */
-  MoveHistory[PLY] = lastmove;
 
   /* release memory */
   if (position) 
@@ -1270,7 +2250,20 @@ static bool setboard(Bitboard *board, char *fenstring)
     free(cep);
 
   /* board valid check */
-  if (!isvalid(board))
+  return isvalid(board);
+}
+/* set game position from fen string, resets game history */
+static bool setboard(Bitboard *board, char *fenstring)
+{
+  bool valid = parsefen(board, &STM, &GAMEPLY, fenstring);
+
+  /* ply starts at zero */
+  PLY = 0;
+  HashHistory[PLY] = board[QBBHASH];
+  /* store lastmove+ in history */
+  MoveHistory[PLY] = board[QBBLAST];
+
+  if (!valid)
   {
     fprintf(stdout,"Error (given fen position is illegal): setboard\n");        
     if (LogFile)
@@ -1288,13 +2281,25 @@ static void selftest(void)
 {
   Score scorea = 0;
   Score scoreb = 0;
+  u64 nodecount;
   u64 done;
   u64 passed = 0;
-  const u64 todo = 41;
+  const u64 todo = 49;
+  u64 errors;
+  s32 i, j;
+  s32 movecounter;
+  s32 childcounter;
   Move move;
+  Move lastmove;
+  Move childlastmove;
+  Cr cr;
+  Cr childcr;
   Hash hash;
+  Hash childhash;
   Hash computedhash;
   Hash incrementalhash;
+  Move moves[MAXMOVES];
+  Move childmoves[MAXMOVES];
 
   char movesc1[6][5] =
   {
@@ -1374,9 +2379,6 @@ static void selftest(void)
 
   for (done=0;done<23;done++)
   {
-    NODECOUNT = 0;
-    MOVECOUNT = 0;
-
     SD = depths[done];
     
     fprintf(stdout,"# doing perft depth: %d for position %" PRIu64 " of 23\n", SD, done+1);
@@ -1401,37 +2403,96 @@ static void selftest(void)
     /* time measurement */
     start = get_time();
     /* perfomance test, just leaf nodecount to given depth */
-    perft(BOARD, STM, SD);
+    nodecount = perft(BOARD, STM, SD);
     /* time measurement */
     end = get_time();   
     elapsed = end-start;
 
-    if(NODECOUNT==nodecounts[done]&&scorea==scoreb)
+    if(nodecount==nodecounts[done]&&scorea==scoreb)
       passed++;
 
-    if(NODECOUNT==nodecounts[done])
+    if(nodecount==nodecounts[done])
     {
       fprintf(stdout,"#> OK, Nodecount Correct, %" PRIu64 " nodes in %lf seconds with \
-%" PRIu64 " nps.\n", NODECOUNT, (elapsed/1000), (u64)(NODECOUNT/(elapsed/1000)));
+%" PRIu64 " nps.\n", nodecount, (elapsed/1000), (u64)(nodecount/(elapsed/1000)));
       if (LogFile)
       {
         fprintdate(LogFile);
         fprintf(LogFile,"#> OK, Nodecount Correct, %" PRIu64 " nodes in %lf seconds with \
-%" PRIu64 " nps.\n", NODECOUNT, (elapsed/1000), (u64)(NODECOUNT/(elapsed/1000)));
+%" PRIu64 " nps.\n", nodecount, (elapsed/1000), (u64)(nodecount/(elapsed/1000)));
       }
     }
     else
     {
       fprintf(stdout,"#> Error, Nodecount NOT Correct, %" PRIu64 " computed nodes != %" PRIu64 " \
-nodes for depth %d.\n", NODECOUNT, nodecounts[done], SD);
+nodes for depth %d.\n", nodecount, nodecounts[done], SD);
       if (LogFile)
       {
         fprintdate(LogFile);
         fprintf(LogFile,"#> Error, Nodecount NOT Correct, %" PRIu64 " computed nodes != %" PRIu64 " \
-nodes for depth %d.\n", NODECOUNT, nodecounts[done], SD);
+nodes for depth %d.\n", nodecount, nodecounts[done], SD);
       }
     }
   }
+  /* test child hash of move against incremental hash, two plies deep */
+  fprintf(stdout,"#\n");
+  fprintf(stdout,"# doing child hash checks\n");
+  if (LogFile)
+  {
+    fprintdate(LogFile);
+    fprintf(LogFile,"#\n");
+    fprintdate(LogFile);
+    fprintf(LogFile,"# doing child hash checks\n");
+  }
+  errors = 0;
+  for (done=0;done<23;done++)
+  {
+    if (!setboard(BOARD, fenpositions[done]))
+      continue;
+    movecounter = genmoves_general(BOARD, moves, 0, STM, false);
+    for (i=0;i<movecounter;i++)
+    {
+      lastmove = BOARD[QBBLAST];
+      cr = BOARD[QBBPMVD];
+      hash = BOARD[QBBHASH];
+      computedhash = hashmove(BOARD, moves[i]);
+      domove(BOARD, moves[i]);
+      if (computedhash!=BOARD[QBBHASH])
+        errors++;
+      childcounter = genmoves_general(BOARD, childmoves, 0, !STM, false);
+      for (j=0;j<childcounter;j++)
+      {
+        childlastmove = BOARD[QBBLAST];
+        childcr = BOARD[QBBPMVD];
+        childhash = BOARD[QBBHASH];
+        computedhash = hashmove(BOARD, childmoves[j]);
+        domove(BOARD, childmoves[j]);
+        if (computedhash!=BOARD[QBBHASH])
+          errors++;
+        undomove(BOARD, childmoves[j], childlastmove, childcr, childhash);
+      }
+      undomove(BOARD, moves[i], lastmove, cr, hash);
+    }
+  }
+  if (errors)
+  {
+    fprintf(stdout,"#> Error, child hash NOT Correct for %" PRIu64 " moves\n", errors);
+    if (LogFile)
+    {
+      fprintdate(LogFile);
+      fprintf(LogFile,"#> Error, child hash NOT Correct for %" PRIu64 " moves\n", errors);
+    }
+  }
+  else
+  {
+    passed++;
+    fprintf(stdout,"#> OK, child hash Correct\n");
+    if (LogFile)
+    {
+      fprintdate(LogFile);
+      fprintf(LogFile,"#> OK, child hash Correct\n");
+    }
+  }
   /* test for book hashes */
   setboard(BOARD,"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
   fprintf(stdout,"#\n");  
@@ -1488,6 +2549,27 @@ nodes for depth %d.\n", NODECOUNT, nodecounts[done], SD);
         fprintf(LogFile,"#> OK, incremental hash Correct, 0x%016" PRIx64 " == 0x%016" PRIx64 "\n", incrementalhash, computedhash);
       }
     }
+    incrementalhash = BOARD[QBBPHASH];
+    computedhash = computepawnhash(BOARD);
+    if(incrementalhash!=computedhash)
+    {
+      fprintf(stdout,"#> Error, incremental pawn hash NOT Correct, 0x%016" PRIx64 " != 0x%016" PRIx64 "\n", incrementalhash, computedhash);
+      if (LogFile)
+      {
+        fprintdate(LogFile);
+        fprintf(LogFile,"#> Error, incremental pawn hash NOT Correct, 0x%016" PRIx64 " != 0x%016" PRIx64 "\n", incrementalhash, computedhash);
+      }
+    }
+    else
+    {
+      passed++;
+      fprintf(stdout,"#> OK, incremental pawn hash Correct, 0x%016" PRIx64 " == 0x%016" PRIx64 "\n", incrementalhash, computedhash);
+      if (LogFile)
+      {
+        fprintdate(LogFile);
+        fprintf(LogFile,"#> OK, incremental pawn hash Correct, 0x%016" PRIx64 " == 0x%016" PRIx64 "\n", incrementalhash, computedhash);
+      }
+    }
     move = can2move(movesc1[done], BOARD, STM);
     domove(BOARD, move);
     STM = !STM;
@@ -1624,6 +2706,7 @@ static void print_help(void)
   fprintf(stdout," -v, --version      Print Zeta Dva version info.\n");
   fprintf(stdout," -h, --help         Print Zeta Dva program usage help.\n");
   fprintf(stdout," -s, --selftest     Run an internal test, usefull after compile.\n");
+  fprintf(stdout," --ttshm NAME       Use shared memory hash table NAME.\n");
   fprintf(stdout,"\n");
   fprintf(stdout,"To play against the engine use an CECP v2 protocol capable chess GUI\n");
   fprintf(stdout,"like Arena, Cutechess, Winboard or Xboard.\n");
@@ -1632,6 +2715,7 @@ static void print_help(void)
   fprintf(stdout,"e.g.:\n");
   fprintf(stdout,"new            // init new game from start position\n");
   fprintf(stdout,"level 40 4 0   // set time control to 40 moves in 4 minutes\n");
+  fprintf(stdout,"cores 4        // search with 4 threads\n");
   fprintf(stdout,"go             // let engine play site to move\n");
   fprintf(stdout,"usermove d7d5  // let engine apply usermove in coordinate algebraic\n");
   fprintf(stdout,"               // notation and optionally start thinking\n");
@@ -1649,9 +2733,29 @@ static void print_help(void)
   fprintf(stdout,"selftest       // run an internal test\n");
   fprintf(stdout,"help           // print usage info\n");
   fprintf(stdout,"log            // turn log on\n");
+  fprintf(stdout,"savehash FILE  // write hash table to file\n");
+  fprintf(stdout,"loadhash FILE  // read hash table from file\n");
+  fprintf(stdout,"clearhash      // clear hash table, kept on new and setboard\n");
+  fprintf(stdout,"etc on|off     // switch enhanced transposition cutoffs\n");
+  fprintf(stdout,"rfp on|off     // switch reverse futility pruning\n");
+  fprintf(stdout,"futility on|off// switch futility pruning of quiet moves\n");
+  fprintf(stdout,"razoring on|off// switch razoring into quiescence search\n");
+  fprintf(stdout,"probcut on|off // switch probcut by good captures\n");
+  fprintf(stdout,"lmp on|off     // switch late move pruning of quiet moves\n");
+  fprintf(stdout,"iir on|off     // internal iterative reductions instead of iid\n");
+  fprintf(stdout,"smp lazy|ybwc  // smp mode, shared tt or young brothers wait splits\n");
+  fprintf(stdout,"smpbench       // compare smp modes with cores threads to 1 thread,\n");
+  fprintf(stdout,"               // depth set by sd command\n");
+  fprintf(stdout,"sharedhash NAME// attach to shared memory hash table NAME, size\n");
+  fprintf(stdout,"               // set by memory of first process, off to detach\n");
+  fprintf(stdout,"epdbatch IN OUT// analyse epd file IN with cores threads, write bm,\n");
+  fprintf(stdout,"               // ce, acd, acn and pv to OUT, optional limits\n");
+  fprintf(stdout,"               // threads N depth N nodes N time MS, else sd and\n");
+  fprintf(stdout,"               // st are used, hash MB for private tt per thread\n");
   fprintf(stdout,"\n");
 }
-/* Zeta Dva, amateur level chess engine  */
+/* Zeta Dva, amateur level chess engine, not part of libzetadva.a  */
+#ifndef ZETADVA_LIB
 int main(int argc, char* argv[])
 {
   /* xboard states */
@@ -1664,6 +2768,7 @@ int main(int argc, char* argv[])
     {"version", 0, 0, 'v'},
     {"selftest", 0, 0, 's'},
     {"log", 0, 0, 'l'},
+    {"ttshm", 1, 0, 'm'},
     {NULL, 0, NULL, 0}
   };
   s32 option_index = 0;
@@ -1716,6 +2821,13 @@ int main(int argc, char* argv[])
         break;
       case 3:
         break;
+      case 4:
+        if (!attachsharedTT(optarg))
+        {
+          release_inits ();
+          exit (EXIT_FAILURE);
+        }
+        break;
     }
   }
   /* open log file */
@@ -1757,8 +2869,9 @@ int main(int argc, char* argv[])
     fflush (stdout);
     if (LogFile)
       fflush (LogFile);
-    /* get Line */
-    if (!fgets (Line, 1023, stdin)) {}
+    /* get Line, end of input quits, releases shared hash table */
+    if (!fgets (Line, 1023, stdin))
+      break;
     /* ignore empty Lines */
     if (Line[0] == '\n')
       continue;
@@ -1849,7 +2962,7 @@ int main(int argc, char* argv[])
         if (strstr(Command, "accepted"))
           xboard_debug = true;
         fprintf(stdout,"feature memory=1\n");
-        fprintf(stdout,"feature smp=0\n");
+        fprintf(stdout,"feature smp=1\n");
         fprintf(stdout,"feature san=0\n");
         fprintf(stdout,"feature exclude=0\n");
         fprintf(stdout,"feature done=1\n");
@@ -1874,7 +2987,7 @@ int main(int argc, char* argv[])
         }
       }
       SD = MAXPLY;
-      initTT();
+      ageTT();
       if (!xboard_mode)
         printboard(BOARD);
       xboard_force  = false;
@@ -1893,7 +3006,7 @@ int main(int argc, char* argv[])
           fprintf(LogFile,"Error (in setting chess psotition via fen string): setboard\n");        
         }
       }
-      initTT();
+      ageTT();
       if (!xboard_mode)
         printboard(BOARD);
       continue;
@@ -1918,14 +3031,12 @@ int main(int argc, char* argv[])
         Move move;
         Move moves[MAXMOVES];
         xboard_force = false;
-        NODECOUNT = 0;
-        MOVECOUNT = 0;
         start = get_time();
 
         HashHistory[PLY] = BOARD[QBBHASH];
 
         kic = kingincheck(BOARD, STM);
-        movecounter = genmoves(BOARD, moves, movecounter, STM, false, 0);
+        movecounter = genmoves(NULL, BOARD, moves, movecounter, STM, false, 0);
         /* print checkmate and stalemate result */
         if (PLY>=MAXGAMEPLY)
         {
@@ -1956,7 +3067,7 @@ int main(int argc, char* argv[])
         else 
         {
           /* start thinking */
-          move = rootsearch(BOARD,STM, SD);
+          move = think();
 
           fprintf(stdout,"move ");
           if (LogFile)
@@ -2087,7 +3198,39 @@ int main(int argc, char* argv[])
 		if (!strcmp(Command, "memory"))
     {
       sscanf(Line, "memory %" PRIu64"", &xboardmb);
-      initTT();
+      resizeTT();
+      continue;
+    }
+    /* number of search threads */
+    if (!strcmp(Command, "cores"))
+    {
+      sscanf(Line, "cores %d", &CORES);
+      CORES = MAX(1, MIN(CORES, MAXTHREADS));
+      continue;
+    }
+    /* smp mode, lazy smp or young brothers wait */
+    if (!strcmp(Command, "smp"))
+    {
+      if (sscanf(Line, "smp %1023s", Fen)!=1
+          ||(strcmp(Fen, "lazy")&&strcmp(Fen, "ybwc")))
+        fprintf(stdout,"Error (expected lazy or ybwc): smp\n");
+      else
+        SMPMODE = (!strcmp(Fen, "ybwc"))?SMPYBWC:SMPLAZY;
+      continue;
+    }
+    /* analyse epd file with worker threads */
+    if (!xboard_mode && !strcmp(Command, "epdbatch"))
+    {
+      epdbatch(Line);
+      continue;
+    }
+    /* compare smp modes on current position to depth set by sd */
+    if (!xboard_mode && !strcmp(Command, "smpbench"))
+    {
+      if (CORES<2)
+        fprintf(stdout,"Error (set cores >= 2): smpbench\n");
+      else
+        smpbench();
       continue;
     }
     if (!strcmp(Command, "usermove"))
@@ -2127,7 +3270,7 @@ int main(int argc, char* argv[])
       if (!xboard_force)
       {
         kic = kingincheck(BOARD, STM);
-        movecounter = genmoves(BOARD, moves, movecounter, STM, false, 0);
+        movecounter = genmoves(NULL, BOARD, moves, movecounter, STM, false, 0);
         /* print checkmate and stalemate result */
         if (PLY>=MAXGAMEPLY)
         {
@@ -2173,7 +3316,7 @@ int main(int argc, char* argv[])
         else 
         {
           /* start thinking */
-          move = rootsearch(BOARD,STM, SD);
+          move = think();
 
           fprintf(stdout,"move ");
           if (LogFile)
@@ -2348,8 +3491,7 @@ int main(int argc, char* argv[])
     /* do an node count to depth defined via sd  */
     if (!xboard_mode && !strcmp(Command, "perft"))
     {
-      NODECOUNT = 0;
-      MOVECOUNT = 0;
+      u64 nodecount;
 
       fprintf(stdout,"### doing perft depth %d: ###\n", SD);  
       if (LogFile)
@@ -2360,18 +3502,18 @@ int main(int argc, char* argv[])
 
       start = get_time();
 
-      perft(BOARD, STM, SD);
+      nodecount = perft(BOARD, STM, SD);
 
       end = get_time();   
       elapsed = end-start;
 
       fprintf(stdout,"nodecount:%" PRIu64 ", seconds: %lf, nps: %" PRIu64 " \n", 
-              NODECOUNT, (elapsed/1000), (u64)(NODECOUNT/(elapsed/1000)));
+              nodecount, (elapsed/1000), (u64)(nodecount/(elapsed/1000)));
       if (LogFile)
       {
         fprintdate(LogFile);
         fprintf(LogFile,"nodecount:%" PRIu64 ", seconds: %lf, nps: %" PRIu64 " \n", 
-              NODECOUNT, (elapsed/1000), (u64)(NODECOUNT/(elapsed/1000)));
+              nodecount, (elapsed/1000), (u64)(nodecount/(elapsed/1000)));
       }
 
       fflush(stdout);
@@ -2379,6 +3521,120 @@ int main(int argc, char* argv[])
   
       continue;
     }
+    /* write hash table to file */
+    if (!strcmp(Command, "savehash"))
+    {
+      if (sscanf(Line, "savehash %1023s", Fen)!=1)
+        fprintf(stdout,"Error (missing file name): savehash\n");
+      else if (savehash(Fen)&&!xboard_mode)
+        fprintf(stdout,"# saved %" PRIu64 " hash entries to %s\n", TT.entries, Fen);
+      continue;
+    }
+    /* read hash table from file */
+    if (!strcmp(Command, "loadhash"))
+    {
+      if (sscanf(Line, "loadhash %1023s", Fen)!=1)
+        fprintf(stdout,"Error (missing file name): loadhash\n");
+      else if (loadhash(Fen)&&!xboard_mode)
+        fprintf(stdout,"# loaded %" PRIu64 " hash entries, %" PRIu64 " mb, from %s\n", TT.entries, xboardmb, Fen);
+      continue;
+    }
+    /* clear hash table, shared table too */
+    if (!strcmp(Command, "clearhash"))
+    {
+      if (TTShm)
+        clearTT(TT.slots, TT.entries);
+      initTT();
+      continue;
+    }
+    /* switch enhanced transposition cutoffs */
+    if (!xboard_mode && !strcmp(Command, "etc"))
+    {
+      if (sscanf(Line, "etc %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): etc\n");
+      else
+        ETC = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* switch reverse futility pruning */
+    if (!xboard_mode && !strcmp(Command, "rfp"))
+    {
+      if (sscanf(Line, "rfp %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): rfp\n");
+      else
+        RFP = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* switch futility pruning */
+    if (!xboard_mode && !strcmp(Command, "futility"))
+    {
+      if (sscanf(Line, "futility %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): futility\n");
+      else
+        FUTILITY = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* switch razoring */
+    if (!xboard_mode && !strcmp(Command, "razoring"))
+    {
+      if (sscanf(Line, "razoring %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): razoring\n");
+      else
+        RAZORING = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* switch probcut */
+    if (!xboard_mode && !strcmp(Command, "probcut"))
+    {
+      if (sscanf(Line, "probcut %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): probcut\n");
+      else
+        PROBCUT = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* switch late move pruning */
+    if (!xboard_mode && !strcmp(Command, "lmp"))
+    {
+      if (sscanf(Line, "lmp %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): lmp\n");
+      else
+        LMP = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* switch internal iterative reductions */
+    if (!xboard_mode && !strcmp(Command, "iir"))
+    {
+      if (sscanf(Line, "iir %1023s", Fen)!=1
+          ||(strcmp(Fen, "on")&&strcmp(Fen, "off")))
+        fprintf(stdout,"Error (expected on or off): iir\n");
+      else
+        IIR = (!strcmp(Fen, "on"))?true:false;
+      continue;
+    }
+    /* attach to or detach from shared memory hash table */
+    if (!strcmp(Command, "sharedhash"))
+    {
+      if (sscanf(Line, "sharedhash %255s", Fen)!=1)
+        fprintf(stdout,"Error (missing shared memory name): sharedhash\n");
+      else if (!strcmp(Fen, "off"))
+      {
+        /* back to own table */
+        if (TTShm)
+        {
+          freeTT();
+          initTT();
+        }
+      }
+      else if (attachsharedTT(Fen)&&!xboard_mode)
+        fprintf(stdout,"# attached to shared hash table %s, %" PRIu64 " entries, %" PRIu64 " mb, %" PRIu64 " processes\n", TTShmName, TT.entries, xboardmb, TTShm->attached);
+      continue;
+    }
     /* do an internal self test */
     if (!xboard_mode && !strcmp(Command, "selftest"))
     {
@@ -2445,4 +3701,4 @@ int main(int argc, char* argv[])
   release_inits();
   exit(EXIT_SUCCESS);
 }
-
+#endif /* ZETADVA_LIB */
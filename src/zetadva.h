@@ -24,33 +24,18 @@
 
 /* global variables */
 extern FILE 	*LogFile;
-/* counters */
-extern u64 NODECOUNT;
-extern u64 MOVECOUNT;
-extern u64 TTHITS;
-extern u64 COUNTERS1;
-extern u64 COUNTERS2;
-
-/* timers */
-extern double start;
-extern double end;
-extern double elapsed;
-bool TIMEOUT;  /* global value for time control*/
-/* game state */
-extern bool STM;
-extern s32 SD;
-extern s32 GAMEPLY;
-extern s32 PLY;
-extern Move *MoveHistory;
-extern Hash *HashHistory;
-extern Move *Killers;
-extern Move *Counters;
 extern const Bitboard LRANK[2];
-extern double MaxTime;
+extern u64 *EvalCache;
+extern struct TTable TT;
+extern const Hash Zobrist[17];
 
-extern bool xboard_post;
-extern bool xboard_mode;
-extern bool xboard_debug;
+extern bool ETC;
+extern bool RFP;
+extern bool FUTILITY;
+extern bool RAZORING;
+extern bool PROBCUT;
+extern bool LMP;
+extern bool IIR;
 
 bool squareunderattack(Bitboard *board, bool stm, Square sq);
 bool kingincheck(Bitboard *board, bool stm);
@@ -66,10 +51,16 @@ void printbitboard(Bitboard board);
 void printmove(Move move);
 void printmovecan(Move move);
 Hash computehash(Bitboard *board, bool stm);
-void save_to_tt(Hash hash, TTMove move, Score score, u8 flag, u8 depth);
-struct TTE *load_from_tt(Hash hash);
-s32 collect_pv_from_hash(Bitboard *board, Hash hash, Move *moves, s32 ply);
-void save_killer(Move move, Score score, s32 ply);
+Hash computepawnhash(Bitboard *board);
+Hash hashmove(Bitboard *board, Move move);
+void save_to_tt(struct SearchContext *ctx, Hash hash, TTMove move, Score score, Score eval, u8 flag, s32 depth);
+struct TTE *load_from_tt(struct SearchContext *ctx, Hash hash, struct TTE *tete);
+u64 ttentries(u64 mb);
+s32 hashfull(struct TTable *tt);
+void newttgeneration(struct TTable *tt);
+s32 collect_pv_from_hash(struct SearchContext *ctx, Bitboard *board, Hash hash, Move *moves, s32 ply);
+bool parsefen(Bitboard *board, bool *stm, s32 *gameply, char *fenstring);
+void move2can(Move move, char *movec);
 bool isvalid(Bitboard *board);
 
 #endif /* ZETA_H_INCLUDED */